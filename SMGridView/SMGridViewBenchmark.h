@@ -0,0 +1,37 @@
+//
+//  SMGridViewBenchmark.h
+//  SMGridView
+//
+
+#import <Foundation/Foundation.h>
+
+/**
+ Runs the scenarios that need UIKit (a reload, scroll sweeps, add/remove and sort drags) against an offscreen
+ SMGridView fed by a stand-in dataSource, and reports ns/op, views created and dataSource calls for each one.
+ The layout work alone is measured headless by SMGridViewLayoutBenchmark, see the README.
+
+ The first run is saved as the baseline. Later runs are compared against it and any scenario slower
+ than the baseline by more than maxRegression is reported as a regression.
+ */
+@interface SMGridViewBenchmark : NSObject
+
+// Relative slowdown allowed before a scenario counts as a regression. Default is 0.2 (20%)
+@property (nonatomic, assign) double maxRegression;
+
+/**
+ Runs every scenario on the calling thread, it must be the main one.
+ @return A report with one line per scenario, regressions are marked
+ */
+- (NSString *)run;
+
+/**
+ @return YES if the last run had any scenario slower than the baseline
+ */
+- (BOOL)hasRegressions;
+
+/**
+ Saves the last run as the new baseline
+ */
+- (void)saveBaseline;
+
+@end
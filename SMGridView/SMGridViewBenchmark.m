@@ -0,0 +1,269 @@
+//
+//  SMGridViewBenchmark.m
+//  SMGridView
+//
+
+#import "SMGridViewBenchmark.h"
+#import "SMGridView.h"
+#import <QuartzCore/QuartzCore.h>
+
+#define kBenchmarkBaselineKey @"benchmark_baseline"
+
+static CGFloat const kBenchmarkItemSize = 50;
+// Sweeps go this many screens down the grid and back
+static NSUInteger const kBenchmarkSweepScreens = 40;
+static NSUInteger const kBenchmarkSweepStepsPerScreen = 30;
+static NSUInteger const kBenchmarkUpdates = 200;
+
+/**
+ Stand-in dataSource. Sizes come from the row so runs are repeatable, views are plain UIControls
+ (so they can be dragged) and every call is counted.
+ */
+@interface SMGridViewBenchmarkDataSource : NSObject <SMGridViewDataSource>
+
+@property (nonatomic, assign) NSInteger count;
+@property (nonatomic, assign) BOOL sameSize;
+@property (nonatomic, assign) NSUInteger countCalls;
+@property (nonatomic, assign) NSUInteger sizeCalls;
+@property (nonatomic, assign) NSUInteger viewCalls;
+
+- (void)resetCalls;
+
+@end
+
+@implementation SMGridViewBenchmarkDataSource
+
+@synthesize count = _count;
+@synthesize sameSize = _sameSize;
+@synthesize countCalls = _countCalls;
+@synthesize sizeCalls = _sizeCalls;
+@synthesize viewCalls = _viewCalls;
+
+- (void)resetCalls {
+    _countCalls = 0;
+    _sizeCalls = 0;
+    _viewCalls = 0;
+}
+
+- (NSInteger)smGridView:(SMGridView *)gridView numberOfItemsInSection:(NSInteger)section {
+    _countCalls++;
+    return _count;
+}
+
+- (CGSize)smGridView:(SMGridView *)gridView sizeForIndexPath:(NSIndexPath *)indexPath {
+    _sizeCalls++;
+    if (_sameSize) {
+        return CGSizeMake(kBenchmarkItemSize, kBenchmarkItemSize);
+    }
+    CGFloat varSize[] = {50, 70, 90, 110};
+    return CGSizeMake(kBenchmarkItemSize, varSize[(indexPath.row * 7) % 4]);
+}
+
+- (UIView *)smGridView:(SMGridView *)gridView viewForIndexPath:(NSIndexPath *)indexPath {
+    _viewCalls++;
+    UIView *view = [gridView dequeReusableViewOfClass:[UIControl class]];
+    if (!view) {
+        view = [[[UIControl alloc] init] autorelease];
+    }
+    return view;
+}
+
+- (BOOL)smGridViewSameSize:(SMGridView *)gridView {
+    return _sameSize;
+}
+
+@end
+
+
+// Drag steps the touch events of a real drag end up in
+@interface SMGridView (SMGridViewBenchmarkDrag)
+
+- (BOOL)calculatePositionsDrag;
+- (void)touchUp:(UIControl *)controlView withEvent:(UIEvent *)event;
+
+@end
+
+
+@interface SMGridViewBenchmark () {
+    SMGridView *_gridView;
+    SMGridViewBenchmarkDataSource *_dataSource;
+    NSMutableDictionary *_results;
+    BOOL _hasRegressions;
+    // Time spent waiting for animations, not part of the measure
+    CFTimeInterval _waitTime;
+}
+
+@end
+
+@implementation SMGridViewBenchmark
+
+@synthesize maxRegression = _maxRegression;
+
+- (id)init {
+    self = [super init];
+    if (self) {
+        _maxRegression = 0.2;
+        _results = [[NSMutableDictionary alloc] init];
+    }
+    return self;
+}
+
+- (void)dealloc {
+    [_gridView release];
+    [_dataSource release];
+    [_results release];
+    [super dealloc];
+}
+
+- (BOOL)hasRegressions {
+    return _hasRegressions;
+}
+
+- (void)saveBaseline {
+    [[NSUserDefaults standardUserDefaults] setObject:_results forKey:kBenchmarkBaselineKey];
+    [[NSUserDefaults standardUserDefaults] synchronize];
+}
+
+#pragma mark - Setup
+
+// Fake viewport: a phone sized grid that is never put in a window
+- (void)setupGridWithCount:(NSInteger)count sameSize:(BOOL)sameSize {
+    [_gridView release];
+    [_dataSource release];
+    _dataSource = [[SMGridViewBenchmarkDataSource alloc] init];
+    _dataSource.count = count;
+    _dataSource.sameSize = sameSize;
+    _gridView = [[SMGridView alloc] initWithFrame:CGRectMake(0, 0, 320, 480)];
+    _gridView.vertical = YES;
+    _gridView.numberOfRows = 5;
+    _gridView.dataSource = _dataSource;
+}
+
+// Add and remove animate, the next update waits until the grid is not busy anymore
+- (void)waitForGrid {
+    CFTimeInterval start = CACurrentMediaTime();
+    NSDate *limit = [NSDate dateWithTimeIntervalSinceNow:2];
+    while (_gridView.busy && [limit timeIntervalSinceNow] > 0) {
+        [[NSRunLoop currentRunLoop] runMode:NSDefaultRunLoopMode beforeDate:[NSDate dateWithTimeIntervalSinceNow:0.01]];
+    }
+    _waitTime += CACurrentMediaTime() - start;
+}
+
+#pragma mark - Scenarios
+
+// Only the time inside block is measured. Block returns the number of operations it did
+- (void)measure:(NSString *)name report:(NSMutableString *)report block:(NSUInteger (^)(void))block {
+    [_dataSource resetCalls];
+    [_gridView resetReuseStats];
+    _waitTime = 0;
+    CFTimeInterval time = 0;
+    NSUInteger ops = 0;
+    @autoreleasepool {
+        CFTimeInterval start = CACurrentMediaTime();
+        ops = block();
+        time = CACurrentMediaTime() - start - _waitTime;
+    }
+    ops = MAX(ops, 1);
+    double nsPerOp = time * 1e9 / ops;
+    [_results setObject:[NSNumber numberWithDouble:nsPerOp] forKey:name];
+
+    NSNumber *baseline = [[[NSUserDefaults standardUserDefaults] dictionaryForKey:kBenchmarkBaselineKey] objectForKey:name];
+    NSString *mark = @"";
+    if (baseline && nsPerOp > [baseline doubleValue] * (1 + _maxRegression)) {
+        _hasRegressions = YES;
+        mark = [NSString stringWithFormat:@" REGRESSION (baseline %.0f ns/op)", [baseline doubleValue]];
+    }
+    // Views created are the ones the reuse pool couldn't give, the allocations that matter in a grid
+    [report appendFormat:@"%@: %.0f ns/op, %d ops, views created %d, count/size/view calls %d/%d/%d%@\n",
+     name, nsPerOp, ops, _gridView.reuseMisses, _dataSource.countCalls, _dataSource.sizeCalls, _dataSource.viewCalls, mark];
+}
+
+- (void)benchmarkReload:(NSInteger)count sameSize:(BOOL)sameSize report:(NSMutableString *)report {
+    [self setupGridWithCount:count sameSize:sameSize];
+    NSString *name = [NSString stringWithFormat:@"reloadData %d%@", count, sameSize ? @" same size" : @""];
+    [self measure:name report:report block:^NSUInteger{
+        [_gridView reloadData];
+        return 1;
+    }];
+}
+
+- (void)benchmarkSweepSameSize:(BOOL)sameSize report:(NSMutableString *)report {
+    [self setupGridWithCount:100000 sameSize:sameSize];
+    [_gridView reloadData];
+    CGFloat screen = _gridView.frame.size.height;
+    CGFloat step = screen / kBenchmarkSweepStepsPerScreen;
+    NSUInteger steps = kBenchmarkSweepScreens * kBenchmarkSweepStepsPerScreen;
+    NSString *name = [NSString stringWithFormat:@"scroll sweep%@", sameSize ? @" same size" : @""];
+    [self measure:name report:report block:^NSUInteger{
+        for (NSUInteger i = 0; i < steps; i++) {
+            _gridView.contentOffset = CGPointMake(0, i * step);
+        }
+        for (NSUInteger i = steps; i > 0; i--) {
+            _gridView.contentOffset = CGPointMake(0, (i - 1) * step);
+        }
+        return steps * 2;
+    }];
+}
+
+- (void)benchmarkUpdatesWithReport:(NSMutableString *)report {
+    [self setupGridWithCount:10000 sameSize:NO];
+    [_gridView reloadData];
+    [UIView setAnimationsEnabled:NO];
+    [self measure:@"add/remove" report:report block:^NSUInteger{
+        for (NSUInteger i = 0; i < kBenchmarkUpdates; i++) {
+            NSIndexPath *indexPath = [NSIndexPath indexPathForRow:(i * 37) % _dataSource.count inSection:0];
+            [_gridView performBatchUpdates:^{
+                _dataSource.count++;
+                [_gridView insertItemsAtIndexPaths:[NSArray arrayWithObject:indexPath]];
+            } completion:nil];
+            [self waitForGrid];
+            [_gridView performBatchUpdates:^{
+                _dataSource.count--;
+                [_gridView deleteItemsAtIndexPaths:[NSArray arrayWithObject:indexPath]];
+            } completion:nil];
+            [self waitForGrid];
+        }
+        return kBenchmarkUpdates * 2;
+    }];
+    // A drag to sort: the dragged view goes over its neighbour and back, every step evaluates the drop target
+    // and moves the item like a touch would
+    _gridView.enableSort = YES;
+    _gridView.sortWaitBeforeAnimate = 0;
+    UIControl *dragged = (UIControl *)[_gridView viewForIndexPath:[NSIndexPath indexPathForRow:0 inSection:0]];
+    [_gridView touchDown:dragged withLocationInView:CGPointMake(dragged.frame.size.width/2, dragged.frame.size.height/2)];
+    [self measure:@"sort drag" report:report block:^NSUInteger{
+        NSUInteger moves = 0;
+        for (NSUInteger i = 0; i < kBenchmarkUpdates; i++) {
+            UIView *neighbour = [_gridView viewForIndexPath:[NSIndexPath indexPathForRow:(i % 2 == 0 ? 1 : 0) inSection:0]];
+            dragged.center = neighbour.center;
+            if ([_gridView calculatePositionsDrag]) {
+                moves++;
+            }
+        }
+        return moves;
+    }];
+    [_gridView touchUp:dragged withEvent:nil];
+    [self waitForGrid];
+    _gridView.enableSort = NO;
+    [UIView setAnimationsEnabled:YES];
+}
+
+- (NSString *)run {
+    _hasRegressions = NO;
+    [_results removeAllObjects];
+    NSMutableString *report = [NSMutableString string];
+    [self benchmarkReload:1000 sameSize:NO report:report];
+    [self benchmarkReload:1000 sameSize:YES report:report];
+    [self benchmarkSweepSameSize:YES report:report];
+    [self benchmarkSweepSameSize:NO report:report];
+    [self benchmarkUpdatesWithReport:report];
+    [_gridView release];
+    _gridView = nil;
+    if (![[NSUserDefaults standardUserDefaults] dictionaryForKey:kBenchmarkBaselineKey]) {
+        [self saveBaseline];
+        [report appendString:@"Saved as baseline\n"];
+    }
+    return report;
+}
+
+@end
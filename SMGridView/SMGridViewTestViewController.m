@@ -10,6 +10,7 @@
 #import "IASKAppSettingsViewController.h"
 #import "IASKSettingsReader.h"
 #import "UIColor+Random.h"
+#import "SMGridViewBenchmark.h"
 
 #define kGridMargin 10
 #define kHeaderSize 50
@@ -321,7 +322,8 @@
 
 - (void)setupButtons {
     UIBarButtonItem *settingsButton = [[[UIBarButtonItem alloc] initWithBarButtonSystemItem:UIBarButtonSystemItemEdit target:self action:@selector(settingsAction:)] autorelease];
-    self.navigationItem.rightBarButtonItem = settingsButton;
+    UIBarButtonItem *benchmarkButton = [[[UIBarButtonItem alloc] initWithTitle:@"Bench" style:UIBarButtonItemStyleBordered target:self action:@selector(benchmarkAction:)] autorelease];
+    self.navigationItem.rightBarButtonItems = [NSArray arrayWithObjects:settingsButton, benchmarkButton, nil];
     
     _sortSwitch = [[[UISwitch alloc] init] autorelease];
     [_sortSwitch addTarget:self action:@selector(sortChanged:) forControlEvents:UIControlEventValueChanged];
@@ -354,6 +356,15 @@
     [_gridView removeItemAtIndexPath:[NSIndexPath indexPathForRow:index inSection:section]];
 }
 
+// Runs the benchmark scenarios on offscreen grids, results are compared with the saved baseline and shown in an alert
+- (void)benchmarkAction:(id)sender {
+    SMGridViewBenchmark *benchmark = [[[SMGridViewBenchmark alloc] init] autorelease];
+    NSString *report = [benchmark run];
+    NSString *title = benchmark.hasRegressions ? @"Benchmark regressions" : @"Benchmark";
+    UIAlertView *alert = [[[UIAlertView alloc] initWithTitle:title message:report delegate:nil cancelButtonTitle:@"OK" otherButtonTitles:nil] autorelease];
+    [alert show];
+}
+
 - (void)sortChanged:(UISwitch *)aSwitch {
     _gridView.enableSort = aSwitch.on;
 }
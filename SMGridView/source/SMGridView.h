@@ -83,7 +83,7 @@
 - (void)smGridView:(SMGridView *)gridView willQueueView:(UIView *)view;
 
 /**
- Return yes in this method if all your views have the same size. This will have a big improvement in performance
+ Return yes in this method if all your views have the same size. This will have a big improvement in performance: only the size of the first item of each section is asked, and item rects are computed when needed instead of being stored, in paging mode too
  
  @param gridView The calling SMGridView
  */
@@ -123,6 +123,77 @@
  @return `YES` if an item at the given indexPath can be moved.
  */
 - (BOOL)smGridView:(SMGridView *)gridView canMoveItemAtIndexPath:(NSIndexPath *)indexPath;
+
+/**
+ Implement this method to give the sizes of many items in a single call instead of one [SMGridViewDataSource smGridView:sizeForIndexPath:] per item. Sizes are cached until the next reload or a call to [SMGridView invalidateSizesInSection:] or [SMGridView invalidateSizeAtIndexPath:]
+ 
+ @param gridView The calling SMGridView
+ @param sizes Buffer with room for range.length sizes. sizes[0] is the size of the item at range.location
+ @param section The target section
+ @param range The rows whose size is needed
+ */
+- (void)smGridView:(SMGridView *)gridView sizes:(CGSize *)sizes forItemsInSection:(NSInteger)section range:(NSRange)range;
+
+/**
+ Implement this method for big sections of items with different sizes. Only the items close to the visible area are laid out (and their size asked), the rest take the space of items of this size until the user scrolls to them. The contentOffset is corrected so the visible items don't jump. Not used if pagingEnabled is `YES` or [SMGridViewDataSource smGridViewSameSize:] returns `YES`
+ 
+ @param gridView The calling SMGridView
+ @param section The target section
+ @return The approximate size of the items in the section
+ */
+- (CGSize)smGridView:(SMGridView *)gridView estimatedSizeForItemsInSection:(NSInteger)section;
+
+/**
+ Implement this method to create the views asked by [SMGridView prewarmReusableViewsOfClass:count:]. Otherwise they are created with initWithFrame:
+ 
+ @param gridView The calling SMGridView
+ @param clazz The class of the view
+ @return A new view of the given class, ready to be returned by dequeReusableViewOfClass:. nil stops prewarming this class
+ */
+- (UIView *)smGridView:(SMGridView *)gridView viewForPrewarmingClass:(Class)clazz;
+
+/**
+ Implement this method to start preparing the data of items (decoding images...) before they are asked in [SMGridViewDataSource smGridView:viewForIndexPath:]. It is called while scrolling for the items ahead of the scroll direction, the faster the scroll the further ahead
+ 
+ @param gridView The calling SMGridView
+ @param indexPaths Array of NSIndexPath that will probably be shown soon
+ */
+- (void)smGridView:(SMGridView *)gridView prefetchIndexPaths:(NSArray *)indexPaths;
+
+/**
+ Called for items given in [SMGridViewDataSource smGridView:prefetchIndexPaths:] that are not needed anymore, because the user slowed down or scrolled back, or because the grid was reloaded or its items changed
+ 
+ @param gridView The calling SMGridView
+ @param indexPaths Array of NSIndexPath whose prefetching can be cancelled
+ */
+- (void)smGridView:(SMGridView *)gridView cancelPrefetchingForIndexPaths:(NSArray *)indexPaths;
+
+/**
+ When [SMGridView loadBudget] is set, items whose view is deferred to a later run loop pass can show a cheap placeholder meanwhile. Placeholders go to their own reuse pool, not to the one of the item views, so use [SMGridView dequeReusablePlaceholderView] here to get one back
+ 
+ @param gridView The calling SMGridView
+ @param indexPath The indexPath of the deferred item
+ @return A view shown until the real one is created. nil for no placeholder
+ */
+- (UIView *)smGridView:(SMGridView *)gridView placeholderViewForIndexPath:(NSIndexPath *)indexPath;
+
+/**
+ Implement this method to use [SMGridView reloadDataWithUpdates:completion:]. An identifier must be unique in its section and stay the same for an item from one snapshot to the next (a database id for example). They are compared with isEqual: and hash
+ 
+ @param gridView The calling SMGridView
+ @param section The target section
+ @return Array with the identifier of every item in the section, in order
+ */
+- (NSArray *)smGridView:(SMGridView *)gridView identifiersForItemsInSection:(NSInteger)section;
+
+/**
+ Implement this method so [SMGridView reloadDataWithUpdates:completion:] asks again only the views of the items whose content changed. A token stands for what an item shows (a version number or a modification date for example), it is compared with isEqual: to the token of the same identifier in the previous snapshot. Without this method every kept item with a view is asked again
+ 
+ @param gridView The calling SMGridView
+ @param section The target section
+ @return Array with the token of every item in the section, in the same order as the identifiers
+ */
+- (NSArray *)smGridView:(SMGridView *)gridView contentTokensForItemsInSection:(NSInteger)section;
 @end
 
 
@@ -202,6 +273,43 @@
 @end
 
 
+#define SMGridViewLatencyBucketCount 16
+
+/**
+ Latency distribution of one kind of operation. Bucket i counts the samples between 2^i and 2^(i+1) microseconds (bucket 0 also takes the ones under 1us, the last one everything above)
+ */
+typedef struct {
+    NSUInteger count;
+    double totalMicroseconds;
+    double maxMicroseconds;
+    NSUInteger buckets[SMGridViewLatencyBucketCount];
+} SMGridViewLatencyHistogram;
+
+/**
+ Counters and latencies of the grid hot paths, since it was created or since the last resetMetrics
+ */
+typedef struct {
+    // Calls to loadViewsForPos, one per scroll event plus the ones after changes
+    NSUInteger loadPasses;
+    // Layouts of the grid items, full or partial
+    NSUInteger relayouts;
+    // Item sizes asked to the dataSource, a sizes:forItemsInSection:range: call counts every item it fills
+    NSUInteger sizeRequests;
+    // Item and header views asked to the dataSource
+    NSUInteger viewRequests;
+    // Item views queued for reuse
+    NSUInteger viewsQueued;
+    NSUInteger reuseHits;
+    NSUInteger reuseMisses;
+    NSUInteger reuseEvictions;
+    SMGridViewLatencyHistogram loadPassLatency;
+    SMGridViewLatencyHistogram relayoutLatency;
+    // One sample per dataSource call, so a batched sizes call is a single sample
+    SMGridViewLatencyHistogram sizeRequestLatency;
+    SMGridViewLatencyHistogram viewRequestLatency;
+} SMGridViewMetrics;
+
+
 /**
  This open-source class allows you to have a custom grid that will use methods similar to UITableView (and UITableViewDataSource and UITableViewDelegate) and that supports a lot of extra functionality like:
  
@@ -217,11 +325,8 @@
  * Ability to display a loader at the end of the grid
  */
 @interface SMGridView : UIScrollView<UIScrollViewDelegate> {
-    NSMutableArray *_reusableViews;
-    NSMutableArray *_items;
-    NSMutableArray *_headerItems;
-    NSMutableArray *_visibleItems;
-    NSMutableArray *_bucketItems;
+    CFMutableDictionaryRef _reusePools;
+    NSMutableArray *_sections;
     id<SMGridViewDataSource> _dataSource;
     id<SMGridViewDelegate> _gridDelegate;
     NSInteger _currentPage;
@@ -236,6 +341,15 @@
     int _draggingSection;
     NSUInteger _currentOffsetPage;
     BOOL _addingOrRemoving;
+    NSUInteger _lastLoadCreatedViews;
+    NSUInteger _lastLoadRecycledViews;
+    NSUInteger _maxReusableViewsPerClass;
+    SMGridViewMetrics _metrics;
+    CGFloat _minDeltaLoad;
+    CGFloat _maxDeltaLoad;
+    CGRect _lastLoadRect;
+    float _scrollVelocity;
+    NSUInteger _loadBudget;
 }
 
 /**
@@ -260,9 +374,31 @@
 
 /**
  In logical pixels, how much more of the size of the grid is being preloaded.
+ Setting it gives a fixed load window: minDeltaLoad and maxDeltaLoad are set to this value. Reading it gives
+ the most that is preloaded, the larger of minDeltaLoad and maxDeltaLoad (800 by default)
  */
 @property (nonatomic, assign) CGFloat deltaLoad;
 
+/**
+ In logical pixels, how much is preloaded behind the scroll direction, and on both sides when the grid is still. Default is 50
+ */
+@property (nonatomic, assign) CGFloat minDeltaLoad;
+
+/**
+ In logical pixels, the maximum preloaded ahead of the scroll direction. The faster the scroll, the more is preloaded ahead, up to this value. Default is 800
+ */
+@property (nonatomic, assign) CGFloat maxDeltaLoad;
+
+/**
+ Rect used in the last load pass: views intersecting it are loaded, the rest are queued for reuse
+ */
+@property (nonatomic, readonly) CGRect lastLoadRect;
+
+/**
+ Current scroll speed along the scroll axis, in logical pixels per second. Negative when scrolling back, 0 when the grid is still
+ */
+@property (nonatomic, readonly) float scrollVelocity;
+
 /**
  In logical pixels, use this property to make possible to preload the loaderView before it appears in the screen
  */
@@ -342,17 +478,63 @@
 @property (nonatomic, readonly) BOOL hasItems;
 
 /**
- Determines time to wait after the user stops moving a view before the sort animation starts (To be deprecated)
+ Determines time to wait after the user stops moving a view before the sort animation starts (To be deprecated).
+ While the grid scrolls by itself near an edge the drop target is checked once per frame instead
  */
 @property (nonatomic, assign) NSTimeInterval sortWaitBeforeAnimate;
 
 /**
- Call this method once your dataSource is ready to create the views inside the grid
+ Number of views (including headers) asked to the dataSource during the last load pass
+ */
+@property (nonatomic, readonly) NSUInteger lastLoadCreatedViews;
+
+/**
+ Number of views queued for reuse during the last load pass
+ */
+@property (nonatomic, readonly) NSUInteger lastLoadRecycledViews;
+
+/**
+ In microseconds, time a load pass can spend asking views to the dataSource. Items in the visible rect are always loaded and go first, then the ones in the preload margin, closest to the visible rect first. Once the budget is spent the rest are loaded in later run loop passes. 0 (default) loads everything in the same pass
+ */
+@property (nonatomic, assign) NSUInteger loadBudget;
+
+/**
+ Maximum number of reusable views kept for each view class. Views queued once the pool of their class is full are released. Default is 256
+ */
+@property (nonatomic, assign) NSUInteger maxReusableViewsPerClass;
+
+/**
+ Number of dequeReusableView or dequeReusableViewOfClass: calls that returned a view
+ */
+@property (nonatomic, readonly) NSUInteger reuseHits;
+
+/**
+ Number of dequeReusableView or dequeReusableViewOfClass: calls that returned nil
+ */
+@property (nonatomic, readonly) NSUInteger reuseMisses;
+
+/**
+ Number of views released instead of queued because the pool of their class was full
+ */
+@property (nonatomic, readonly) NSUInteger reuseEvictions;
+
+/**
+ Number of views waiting to be reused, of all classes
+ */
+@property (nonatomic, readonly) NSUInteger numberOfReusableViews;
+
+/**
+ Snapshot of the hot path counters and latencies. Always collected, it only costs a few increments and a clock read per load pass, layout and dataSource call. reuseHits, reuseMisses and reuseEvictions are the same counters as the properties with those names
+ */
+@property (nonatomic, readonly) SMGridViewMetrics metrics;
+
+/**
+ Call this method once your dataSource is ready to create the views inside the grid. If the grid is busy, the reload is queued until it finishes
  */
 - (void)reloadData;
 
 /**
- Like method reloadData but only for a specific section
+ Like method reloadData but only for a specific section. If the grid is busy, the reload is queued until it finishes
  
  @param section Index of section to reload
  */
@@ -371,12 +553,44 @@
 - (void)reloadDataOnlyNew;
 
 /**
- Use this method when you know the dataSource only added new items (and didn't change the ones before) to the given section.
+ Use this method when you know the dataSource only added new items (and didn't change the ones before) to the given section. If the grid is busy, the reload is queued until it finishes.
  
  @param section The index of the section to reload
  */
 - (void)reloadSectionOnlyNew:(NSInteger)section;
 
+/**
+ Use this method when the dataSource added count items at the end of the given section. Only the new items are laid out and the sections after it are moved. A section that was empty is laid out with its new items. If the dataSource doesn't have exactly count more items, the section is reloaded.
+ 
+ @param count Number of items added
+ @param section The index of the section
+ */
+- (void)appendItems:(NSUInteger)count toSection:(NSInteger)section;
+
+/**
+ Like appendItems:toSection: for items added at the beginning of the section, like older messages in a chat. The contentOffset moves by the space taken by the new items, so what is on screen stays in place.
+ 
+ When the new items end at the same position in every row (always with one row), only they are laid out and the rest of the section moves as a whole, so the cost doesn't depend on the section size. Otherwise the section is placed again with the sizes it already has, without asking the dataSource.
+ 
+ @param count Number of items added
+ @param section The index of the section
+ */
+- (void)prependItems:(NSUInteger)count toSection:(NSInteger)section;
+
+/**
+ Sizes given by the dataSource are cached. Call this method when the sizes of the items in a section changed, they will be asked again and the grid will be laid out from there. Views being shown keep their frame size, update them if needed.
+ 
+ @param section The index of the section
+ */
+- (void)invalidateSizesInSection:(NSInteger)section;
+
+/**
+ Like invalidateSizesInSection: for a single item
+ 
+ @param indexPath The indexPath of the item whose size changed
+ */
+- (void)invalidateSizeAtIndexPath:(NSIndexPath *)indexPath;
+
 /**
  Call this method to get a reusable view
  
@@ -392,11 +606,65 @@
  */
 - (UIView *)dequeReusableViewOfClass:(Class)clazz;
 
+/**
+ Call this method inside [SMGridViewDataSource smGridView:placeholderViewForIndexPath:] to reuse a placeholder. They are kept apart from the item views, so dequeReusableView never returns one
+ 
+ @return A placeholder that was shown before, or nil if none is available
+ */
+- (UIView *)dequeReusablePlaceholderView;
+
 /**
  Call this method to remove the reusable views
  */
 - (void)clearReusableViews;
 
+/**
+ Overrides maxReusableViewsPerClass for one class
+ 
+ @param maxCount Maximum number of reusable views of this class
+ @param clazz The class of the views
+ */
+- (void)setMaxReusableViews:(NSUInteger)maxCount forClass:(Class)clazz;
+
+/**
+ @param clazz The class of the views
+ @return Number of views of this class waiting to be reused
+ */
+- (NSUInteger)numberOfReusableViewsOfClass:(Class)clazz;
+
+/**
+ Creates views of a class ahead of time so the first scroll after reloadData can reuse them. Views are created a few at a time, when the run loop is idle and not while scrolling, until there are count views of this class waiting to be reused (limited by maxReusableViewsPerClass)
+ 
+ @param clazz The class of the views
+ @param count Number of views of this class to keep ready
+ */
+- (void)prewarmReusableViewsOfClass:(Class)clazz count:(NSUInteger)count;
+
+/**
+ Sets reuseHits, reuseMisses and reuseEvictions to 0
+ */
+- (void)resetReuseStats;
+
+/**
+ Sets every counter and histogram in metrics to 0, reuse stats included
+ */
+- (void)resetMetrics;
+
+/**
+ Number of trace events kept, once full the oldest ones are overwritten. Any value but 0 records a timed span for every reloadData, updateItems, load pass and dataSource view or size call, with the section and row it was for. 0 (default) stops recording and frees the events
+ */
+@property (nonatomic, assign) NSUInteger traceCapacity;
+
+/**
+ @return The recorded spans, oldest first, in Chrome trace event JSON. It can be opened in chrome://tracing or Perfetto
+ */
+- (NSData *)traceJSONData;
+
+/**
+ Removes the recorded spans, recording goes on
+ */
+- (void)clearTrace;
+
 /**
  Like method addItemAtIndexPath:scroll: with scroll to `YES`
  
@@ -405,7 +673,7 @@
 - (void)addItemAtIndexPath:(NSIndexPath *)indexPath;
 
 /**
- You should call this method once the dataSource has already addded the item
+ You should call this method once the dataSource has already addded the item. If another item is being added or removed, this one is queued until it finishes
  
  @param indexPath The indexPath where the new item is in the property dataSource
  @param scroll indicates wether the grid should scroll to show the animation or not
@@ -420,13 +688,61 @@
 - (void)removeItemAtIndexPath:(NSIndexPath *)indexPath;
 
 /**
- You should call this method before the property dataSource has removed the item. Once the item is removed (after the animation), the dataSource will receive a call to smGridView:performRemoveIndexPath: to finally remove the item
+ You should call this method before the property dataSource has removed the item. Once the item is removed (after the animation), the dataSource will receive a call to smGridView:performRemoveIndexPath: to finally remove the item. If another item is being added or removed, this one is queued until it finishes
  
  @param indexPath The indexPath in the property dataSource you want to remove
  @param scroll indicates wether the grid should scroll to show the animation or not
  */
 - (void)removeItemAtIndexPath:(NSIndexPath *)indexPath scroll:(BOOL)scroll;
 
+/**
+ Groups several inserts, deletes, moves and section reloads so they are laid out once and animated together.
+ Update the dataSource inside (or before) the updates block. Deleted indexPaths refer to the state before the updates and inserted ones to the state after them, like in UICollectionView. Deletes done this way don't call [SMGridViewDataSource smGridView:performRemoveIndexPath:].
+ If the grid is busy, the whole batch (updates block included) is queued and performed when it finishes.
+ 
+ @param updates Block calling insertItemsAtIndexPaths:, deleteItemsAtIndexPaths:, moveItemAtIndexPath:toIndexPath: or reloadSections:
+ @param completion Called once all animations finished. Can be nil
+ */
+- (void)performBatchUpdates:(void (^)(void))updates completion:(void (^)(BOOL finished))completion;
+
+/**
+ Reloads the grid from a new snapshot of the dataSource, changing only what is different. Identifiers are asked to [SMGridViewDataSource smGridView:identifiersForItemsInSection:] before and after updates. The deletes, inserts and moves between them are found with Heckel's diff, linear except for the O(n log n) pass that picks the fewest moves, and applied as a batch. Common items at both ends are skipped first, so n is the size of the changed part. Views of the items still there are kept, except the ones whose content changed: their size and view are asked again. Changes are found with [SMGridViewDataSource smGridView:contentTokensForItemsInSection:], without it every kept item on screen is asked again.
+ If the number of sections changes, or the dataSource doesn't give identifiers, every section is reloaded instead.
+ 
+ @param updates Block where the dataSource switches to the new snapshot
+ @param completion Called once all animations finished. Can be nil
+ */
+- (void)reloadDataWithUpdates:(void (^)(void))updates completion:(void (^)(BOOL finished))completion;
+
+/**
+ Inserts new items. If called outside performBatchUpdates:completion: it is a batch on its own
+ 
+ @param indexPaths Array of NSIndexPath where the dataSource has the new items
+ */
+- (void)insertItemsAtIndexPaths:(NSArray *)indexPaths;
+
+/**
+ Deletes items. If called outside performBatchUpdates:completion: it is a batch on its own
+ 
+ @param indexPaths Array of NSIndexPath of the items before being removed from the dataSource
+ */
+- (void)deleteItemsAtIndexPaths:(NSArray *)indexPaths;
+
+/**
+ Moves an item keeping its view. If called outside performBatchUpdates:completion: it is a batch on its own
+ 
+ @param indexPath The indexPath of the item before the move
+ @param newIndexPath The indexPath of the item after the move
+ */
+- (void)moveItemAtIndexPath:(NSIndexPath *)indexPath toIndexPath:(NSIndexPath *)newIndexPath;
+
+/**
+ Lays out the given sections again from the dataSource. If called outside performBatchUpdates:completion: it is a batch on its own
+ 
+ @param sections Indexes of the sections to reload
+ */
+- (void)reloadSections:(NSIndexSet *)sections;
+
 /**
  @param view The view whose indexPath you are interested
  @return The NSIndexPath associated with a view. nil if the view is not being shown
@@ -490,5 +806,18 @@
  */
 - (NSInteger)findClosestPage:(CGPoint)offset;
 
+/**
+ @return The page showing indexPath if pagingEnabled is `YES`
+ @param indexPath IndexPath of the item
+ */
+- (NSInteger)pageForIndexPath:(NSIndexPath *)indexPath;
+
+/**
+ @return The rows of the items shown in a page if pagingEnabled is `YES`, location is NSNotFound if the page has no items
+ @param page Page number
+ @param section Set to the section of those items, it can be NULL
+ */
+- (NSRange)rangeOfItemsInPage:(NSInteger)page section:(NSInteger *)section;
+
 @end
 
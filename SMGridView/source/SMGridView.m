@@ -6,98 +6,785 @@
 //
 
 #import "SMGridView.h"
+#import "SMGridViewLayout.h"
 #import <QuartzCore/QuartzCore.h>
 
 #define CGPointDistance(p1,p2) sqrt(pow(p1.x - p2.x, 2) + pow(p1.y - p2.y, 2))
 
-//#define kSMGridViewDebug 1
-
 static CGFloat const kSMTVdefaultPadding = 5;
 // Defines extra px to preload
 static CGFloat const kSMTVdefaultDeltaLoad = 150;
+// Load window margins, the one ahead grows with the scroll speed up to the max
+static CGFloat const kSMTVdefaultMinDeltaLoad = 50;
+static CGFloat const kSMTVdefaultMaxDeltaLoad = 800;
+// The margin ahead covers what is scrolled in this time
+static CFTimeInterval const kSMdefaultLoadAheadTime = 0.3;
+// Scroll events further apart than this don't give a speed
+static CFTimeInterval const kSMdefaultVelocityMaxInterval = 0.1;
 static CGFloat const kSMTVdefaultPagesToPreload = 1;
 static float const kSMTVanimDuration = 0.2;
 static float const kSMTdefaultDragMinDistance = 30;
-static float const kSMdefaultBucketSize = 500;
+// While sorting, the grid scrolls when the dragged view is closer than this to an edge
+static CGFloat const kSMdefaultDragScrollEdge = 100;
+// Points per second right at the edge once the scroll has sped up
+static CGFloat const kSMdefaultDragScrollMaxSpeed = 800;
+static CFTimeInterval const kSMdefaultDragScrollRampTime = 1;
+// A late frame doesn't jump more than this
+static CFTimeInterval const kSMdefaultDragScrollMaxFrameTime = 1.0 / 30;
+static NSUInteger const kSMdefaultMaxReusableViewsPerClass = 256;
+// Time spent creating prewarmed views on each idle run loop pass
+static CFTimeInterval const kSMdefaultPrewarmSliceDuration = 0.004;
+// Items that will enter the load rect within this time at the current speed are prefetched
+static CFTimeInterval const kSMdefaultPrefetchTime = 0.5;
+// Prefetch region is never longer than this many screens
+static CGFloat const kSMdefaultPrefetchMaxScreens = 3;
 
 enum {
-    SMGridViewSortAnimSpeedNone,
-    SMGridViewSortAnimSpeedSlow,
-    SMGridViewSortAnimSpeedMid,
-    SMGridViewSortAnimSpeedFast,
+    SMGridViewItemFlagToAdd = 1 << 0,
+    SMGridViewItemFlagSized = 1 << 1,
+    // The view is a placeholder, the real one was deferred to a later run loop pass
+    SMGridViewItemFlagPlaceholder = 1 << 2,
 };
-typedef NSUInteger SMGridViewSortAnimSpeed;
+typedef uint8_t SMGridViewItemFlags;
+
+// Lightweight reference to an item (or a section header) inside the item store
+typedef struct {
+    NSInteger section;
+    NSInteger row;
+    BOOL header;
+} SMGridViewItemRef;
 
+static inline SMGridViewItemRef SMGridViewItemRefMake(NSInteger section, NSInteger row) {
+    SMGridViewItemRef item = {section, row, NO};
+    return item;
+}
+
+static inline SMGridViewItemRef SMGridViewHeaderRefMake(NSInteger section) {
+    SMGridViewItemRef item = {section, 0, YES};
+    return item;
+}
 
-@interface SMGridViewItem : NSObject <NSCopying> {    
+static inline SMGridViewLayoutRect SMGridViewLayoutRectFromCGRect(CGRect rect) {
+    SMGridViewLayoutRect layoutRect = {rect.origin.x, rect.origin.y, rect.size.width, rect.size.height};
+    return layoutRect;
 }
 
-@property (nonatomic, assign) CGRect rect;
-@property (nonatomic, assign) UIView *view;
-@property (nonatomic, assign) BOOL toAdd;
-@property (nonatomic, assign) BOOL header;
-@property (nonatomic, readonly) BOOL visible;
-@property (nonatomic, readonly) CGPoint centerPoint;
-@property (nonatomic, retain) NSIndexPath *indexPath;
+static inline CGRect SMGridViewCGRectFromLayoutRect(SMGridViewLayoutRect layoutRect) {
+    return CGRectMake(layoutRect.x, layoutRect.y, layoutRect.width, layoutRect.height);
+}
 
-- (id)initWithRect:(CGRect)rect;
+
+// Moves the values whose row+1 key is in range by delta rows. If reverse is given, it maps values back to their key
+static void SMGridViewShiftRowKeys(CFMutableDictionaryRef dictionary, CFMutableDictionaryRef reverse, NSRange range, NSInteger delta) {
+    CFIndex count = CFDictionaryGetCount(dictionary);
+    if (count == 0 || range.length == 0) {
+        return;
+    }
+    const void **keys = malloc(count * sizeof(void *));
+    const void **values = malloc(count * sizeof(void *));
+    CFDictionaryGetKeysAndValues(dictionary, keys, values);
+    for (CFIndex i = 0; i < count; i++) {
+        if (NSLocationInRange((NSUInteger)keys[i] - 1, range)) {
+            CFDictionaryRemoveValue(dictionary, keys[i]);
+        }
+    }
+    for (CFIndex i = 0; i < count; i++) {
+        if (NSLocationInRange((NSUInteger)keys[i] - 1, range)) {
+            CFDictionarySetValue(dictionary, (const void *)((NSUInteger)keys[i] + delta), values[i]);
+            if (reverse) {
+                CFDictionarySetValue(reverse, values[i], (const void *)((NSUInteger)keys[i] + delta));
+            }
+        }
+    }
+    free(keys);
+    free(values);
+}
+
+// Adds the time since start to histogram
+static inline void SMGridViewLatencyRecord(SMGridViewLatencyHistogram *histogram, CFTimeInterval start) {
+    double microseconds = (CACurrentMediaTime() - start) * 1000000;
+    NSUInteger value = (NSUInteger)microseconds;
+    NSUInteger bucket = 0;
+    while (value > 1 && bucket < SMGridViewLatencyBucketCount - 1) {
+        value >>= 1;
+        bucket++;
+    }
+    histogram->buckets[bucket]++;
+    histogram->count++;
+    histogram->totalMicroseconds += microseconds;
+    histogram->maxMicroseconds = MAX(histogram->maxMicroseconds, microseconds);
+}
+
+enum {
+    SMGridViewTraceSpanReloadData,
+    SMGridViewTraceSpanUpdateItems,
+    SMGridViewTraceSpanLoadPass,
+    SMGridViewTraceSpanViewRequest,
+    SMGridViewTraceSpanHeaderViewRequest,
+    SMGridViewTraceSpanSizeRequest,
+    SMGridViewTraceSpanSizesRequest,
+};
+typedef uint8_t SMGridViewTraceSpan;
+
+static const char *SMGridViewTraceSpanNames[] = {
+    "reloadData",
+    "updateItems",
+    "loadViewsForPos",
+    "viewForIndexPath",
+    "viewForHeaderInSection",
+    "sizeForIndexPath",
+    "sizesForItemsInSection",
+};
+
+// One recorded span. Section and row are -1 when the span is not about an item
+typedef struct {
+    CFTimeInterval start;
+    CFTimeInterval duration;
+    int32_t section;
+    int32_t row;
+    SMGridViewTraceSpan span;
+} SMGridViewTraceEvent;
+
+// An item waiting to be materialized, sorted by distance to the visible rect
+typedef struct {
+    SMGridViewItemRef item;
+    CGFloat distance;
+} SMGridViewDeferredItem;
+
+// Items missing their view in a load pass, collected before any is created
+typedef struct {
+    SMGridViewDeferredItem *items;
+    NSUInteger count;
+    NSUInteger capacity;
+} SMGridViewDeferredItems;
+
+static int SMGridViewDeferredItemCompare(const void *item1, const void *item2) {
+    const SMGridViewDeferredItem *i1 = item1;
+    const SMGridViewDeferredItem *i2 = item2;
+    return i1->distance < i2->distance ? -1 : (i1->distance > i2->distance ? 1 : 0);
+}
+
+/**
+ Item store for one section. Geometry (rects, flags, row positions, checkpoints, paging and the interval index)
+ lives in the C layout core, see SMGridViewLayout.h. Only the views currently materialized are kept here,
+ in a sparse row -> view map.
+ */
+@interface SMGridViewSection : NSObject {
+    SMGridViewLayoutSection *_layout;
+    CFMutableDictionaryRef _views;
+    CFMutableDictionaryRef _viewRows;
+}
+
+@property (nonatomic, assign) NSInteger section;
+@property (nonatomic, assign) NSUInteger count;
+@property (nonatomic, assign) NSUInteger layoutCount;
+@property (nonatomic, assign) CGRect headerRect;
+@property (nonatomic, assign) UIView *headerView;
+@property (nonatomic, assign) BOOL laidOut;
+@property (nonatomic, assign) CGFloat layoutStart;
+@property (nonatomic, readonly) SMGridViewLayoutSection *layout;
+@property (nonatomic, readonly) double *positions;
+// Running max of positions, so the section extent doesn't need to look at every row
+@property (nonatomic, readonly) CGFloat maxPosition;
+@property (nonatomic, readonly) NSUInteger numberOfRows;
+@property (nonatomic, readonly) NSUInteger viewCount;
+// Paging geometry, set every time the section is laid out
+@property (nonatomic, readonly) NSInteger itemsPerRow;
+@property (nonatomic, readonly) NSInteger itemsPerPage;
+@property (nonatomic, readonly) NSInteger firstPage;
+@property (nonatomic, readonly) NSInteger pageCount;
+@property (nonatomic, readonly) BOOL uniform;
+@property (nonatomic, readonly) CGSize uniformSize;
+@property (nonatomic, readonly) CGFloat uniformStart;
+
+- (void)setItemsPerRow:(NSInteger)itemsPerRow itemsPerPage:(NSInteger)itemsPerPage firstPage:(NSInteger)firstPage;
+- (void)useUniformItemSize:(CGSize)size;
+- (void)usePerItemRects;
+- (void)layoutUniformWithStart:(CGFloat)start params:(SMGridViewLayoutParams)params;
+- (void)insertItemAtIndex:(NSUInteger)index;
+- (void)insertItemsInRange:(NSRange)range;
+- (BOOL)prependItemsWithSizes:(const CGSize *)sizes count:(NSUInteger)count flags:(SMGridViewItemFlags)flags params:(SMGridViewLayoutParams)params;
+- (void)removeItemAtIndex:(NSUInteger)index;
+- (void)moveItemAtIndex:(NSUInteger)fromIndex toIndex:(NSUInteger)toIndex;
+- (BOOL)moveItemAndRelayoutAtIndex:(NSUInteger)fromIndex toIndex:(NSUInteger)toIndex params:(SMGridViewLayoutParams)params;
+- (CGRect)rectAtIndex:(NSUInteger)index;
+- (void)setRect:(CGRect)rect atIndex:(NSUInteger)index;
+- (SMGridViewItemFlags)flagsAtIndex:(NSUInteger)index;
+- (void)setFlags:(SMGridViewItemFlags)flags atIndex:(NSUInteger)index;
+- (UIView *)viewAtIndex:(NSUInteger)index;
+- (void)setView:(UIView *)view atIndex:(NSUInteger)index;
+- (NSUInteger)indexOfView:(UIView *)view;
+- (void)enumerateViewsUsingBlock:(void (^)(NSUInteger index, UIView *view, BOOL *stop))block;
+- (void)enumerateItemsFrom:(CGFloat)start to:(CGFloat)end vertical:(BOOL)vertical usingBlock:(void (^)(NSUInteger index, BOOL *stop))block;
+- (void)resetPositionsWithRows:(NSUInteger)rows value:(CGFloat)value;
+- (void)setPosition:(CGFloat)value atRow:(NSUInteger)row;
+- (void)extendPositionsToRows:(NSUInteger)rows value:(CGFloat)value;
+- (void)saveCheckpointAtIndex:(NSUInteger)index;
+- (NSUInteger)restoreCheckpointBeforeIndex:(NSUInteger)index;
+- (void)shiftBy:(CGFloat)delta vertical:(BOOL)vertical;
 
 @end
 
 
-@implementation SMGridViewItem
+@implementation SMGridViewSection
 
-@synthesize rect;
-@synthesize view;
-@synthesize toAdd;
-@synthesize header;
-@synthesize indexPath = _indexPath;
+@synthesize section = _section;
+@synthesize headerView = _headerView;
+@synthesize laidOut = _laidOut;
+@synthesize layout = _layout;
 
-- (id)initWithRect:(CGRect)frame {
-    self = [self init];
+- (id)init {
+    self = [super init];
     if (self) {
-        self.rect = frame;
+        _layout = SMGridViewLayoutSectionCreate();
+        // Keys are row+1 so row 0 never maps to a NULL key. Views are not retained, the grid owns them through its subviews
+        _views = CFDictionaryCreateMutable(kCFAllocatorDefault, 0, NULL, NULL);
+        // And the other way, view -> row+1
+        _viewRows = CFDictionaryCreateMutable(kCFAllocatorDefault, 0, NULL, NULL);
     }
     return self;
 }
 
 - (void)dealloc {
-    [_indexPath release];
+    SMGridViewLayoutSectionFree(_layout);
+    CFRelease(_views);
+    CFRelease(_viewRows);
     [super dealloc];
 }
 
 - (NSString *)description {
-    return [NSString stringWithFormat:@"Index:%@ Frame:%@, toAdd:%d, view:%@ header:%d", self.indexPath, NSStringFromCGRect(rect), toAdd, view!=nil?@"Y":@"N", header];
+    return [NSString stringWithFormat:@"<SMGridViewSection count:%d views:%d header:%@>", self.count, self.viewCount, NSStringFromCGRect(self.headerRect)];
 }
 
-- (CGPoint)centerPoint {
-    return CGPointMake(CGRectGetMidX(self.rect), CGRectGetMidY(self.rect));
+- (NSUInteger)count {
+    return SMGridViewLayoutSectionGetCount(_layout);
 }
 
-- (BOOL)visible {
-    return view != nil;
+- (void)setCount:(NSUInteger)count {
+    SMGridViewLayoutSectionSetCount(_layout, count);
 }
 
-- (BOOL)isEqual:(id)object {
-    if ([object isKindOfClass:[SMGridViewItem class]]) {
-        SMGridViewItem *other = (SMGridViewItem *)object;
-        return [self.indexPath isEqual:other.indexPath] && self.header == other.header && self.toAdd == other.toAdd;
+- (NSUInteger)layoutCount {
+    return SMGridViewLayoutSectionGetLayoutCount(_layout);
+}
+
+- (void)setLayoutCount:(NSUInteger)layoutCount {
+    SMGridViewLayoutSectionSetLayoutCount(_layout, layoutCount);
+}
+
+- (CGRect)headerRect {
+    return SMGridViewCGRectFromLayoutRect(SMGridViewLayoutSectionGetHeaderRect(_layout));
+}
+
+- (void)setHeaderRect:(CGRect)headerRect {
+    SMGridViewLayoutSectionSetHeaderRect(_layout, SMGridViewLayoutRectFromCGRect(headerRect));
+}
+
+- (CGFloat)layoutStart {
+    return SMGridViewLayoutSectionGetLayoutStart(_layout);
+}
+
+- (void)setLayoutStart:(CGFloat)layoutStart {
+    SMGridViewLayoutSectionSetLayoutStart(_layout, layoutStart);
+}
+
+- (double *)positions {
+    return SMGridViewLayoutSectionGetPositions(_layout);
+}
+
+- (CGFloat)maxPosition {
+    return SMGridViewLayoutSectionGetMaxPosition(_layout);
+}
+
+- (NSUInteger)numberOfRows {
+    return SMGridViewLayoutSectionGetNumberOfRows(_layout);
+}
+
+- (NSInteger)itemsPerRow {
+    return SMGridViewLayoutSectionGetItemsPerRow(_layout);
+}
+
+- (NSInteger)itemsPerPage {
+    return SMGridViewLayoutSectionGetItemsPerPage(_layout);
+}
+
+- (NSInteger)firstPage {
+    return SMGridViewLayoutSectionGetFirstPage(_layout);
+}
+
+- (NSInteger)pageCount {
+    return SMGridViewLayoutSectionGetPageCount(_layout);
+}
+
+- (void)setItemsPerRow:(NSInteger)itemsPerRow itemsPerPage:(NSInteger)itemsPerPage firstPage:(NSInteger)firstPage {
+    SMGridViewLayoutSectionSetPaging(_layout, itemsPerRow, itemsPerPage, firstPage);
+}
+
+- (BOOL)uniform {
+    return SMGridViewLayoutSectionIsUniform(_layout);
+}
+
+- (CGSize)uniformSize {
+    SMGridViewLayoutSize size = SMGridViewLayoutSectionGetUniformSize(_layout);
+    return CGSizeMake(size.width, size.height);
+}
+
+- (CGFloat)uniformStart {
+    return SMGridViewLayoutSectionGetUniformStart(_layout);
+}
+
+- (void)useUniformItemSize:(CGSize)size {
+    SMGridViewLayoutSize layoutSize = {size.width, size.height};
+    SMGridViewLayoutSectionUseUniformSize(_layout, layoutSize);
+}
+
+- (void)usePerItemRects {
+    SMGridViewLayoutSectionUsePerItemRects(_layout);
+}
+
+- (void)layoutUniformWithStart:(CGFloat)start params:(SMGridViewLayoutParams)params {
+    SMGridViewLayoutSectionLayoutUniform(_layout, start, params);
+}
+
+- (void)insertItemAtIndex:(NSUInteger)index {
+    NSUInteger count = self.count;
+    index = MIN(index, count);
+    SMGridViewShiftRowKeys(_views, _viewRows, NSMakeRange(index, count - index), 1);
+    SMGridViewLayoutSectionInsertItem(_layout, index);
+}
+
+- (void)insertItemsInRange:(NSRange)range {
+    NSUInteger count = self.count;
+    NSUInteger index = MIN(range.location, count);
+    SMGridViewShiftRowKeys(_views, _viewRows, NSMakeRange(index, count - index), range.length);
+    SMGridViewLayoutSectionInsertItems(_layout, index, range.length);
+}
+
+// Returns NO if the section has to be laid out again, the items are inserted with their sizes anyway
+- (BOOL)prependItemsWithSizes:(const CGSize *)sizes count:(NSUInteger)count flags:(SMGridViewItemFlags)flags params:(SMGridViewLayoutParams)params {
+    SMGridViewShiftRowKeys(_views, _viewRows, NSMakeRange(0, self.count), count);
+    SMGridViewLayoutSize *layoutSizes = malloc(MAX(count, 1) * sizeof(SMGridViewLayoutSize));
+    for (NSUInteger i = 0; i < count; i++) {
+        layoutSizes[i].width = sizes[i].width;
+        layoutSizes[i].height = sizes[i].height;
     }
-    return NO;
+    BOOL laidOut = SMGridViewLayoutSectionPrependItems(_layout, layoutSizes, count, flags, params);
+    free(layoutSizes);
+    return laidOut;
 }
 
-- (NSUInteger)hash {
-    return self.indexPath.hash + (self.header?1:0);
+- (void)removeItemAtIndex:(NSUInteger)index {
+    NSUInteger count = self.count;
+    if (index >= count) {
+        return;
+    }
+    [self setView:nil atIndex:index];
+    SMGridViewShiftRowKeys(_views, _viewRows, NSMakeRange(index + 1, count - index - 1), -1);
+    SMGridViewLayoutSectionRemoveItem(_layout, index);
 }
 
-- (id)copyWithZone:(NSZone *)zone {
-    SMGridViewItem *item = [SMGridViewItem allocWithZone:zone];
-    item.rect = self.rect;
-    item.header = self.header;
-    item.view = self.view;
-    item.toAdd = self.toAdd;
-    item.indexPath = self.indexPath;
-    return item;
+- (void)moveViewAtIndex:(NSUInteger)fromIndex toIndex:(NSUInteger)toIndex {
+    UIView *view = [self viewAtIndex:fromIndex];
+    [self setView:nil atIndex:fromIndex];
+    if (fromIndex < toIndex) {
+        SMGridViewShiftRowKeys(_views, _viewRows, NSMakeRange(fromIndex + 1, toIndex - fromIndex), -1);
+    } else {
+        SMGridViewShiftRowKeys(_views, _viewRows, NSMakeRange(toIndex, fromIndex - toIndex), 1);
+    }
+    [self setView:view atIndex:toIndex];
+}
+
+- (void)moveItemAtIndex:(NSUInteger)fromIndex toIndex:(NSUInteger)toIndex {
+    NSUInteger count = self.count;
+    if (fromIndex == toIndex || fromIndex >= count || toIndex >= count) {
+        return;
+    }
+    [self moveViewAtIndex:fromIndex toIndex:toIndex];
+    SMGridViewLayoutSectionMoveItem(_layout, fromIndex, toIndex);
+}
+
+// Returns NO if the rest of the section has to be laid out again from the move on
+- (BOOL)moveItemAndRelayoutAtIndex:(NSUInteger)fromIndex toIndex:(NSUInteger)toIndex params:(SMGridViewLayoutParams)params {
+    NSUInteger count = self.count;
+    if (fromIndex == toIndex || fromIndex >= count || toIndex >= count) {
+        return YES;
+    }
+    [self moveViewAtIndex:fromIndex toIndex:toIndex];
+    return SMGridViewLayoutSectionMoveItemAndRelayout(_layout, fromIndex, toIndex, params);
+}
+
+- (CGRect)rectAtIndex:(NSUInteger)index {
+    return SMGridViewCGRectFromLayoutRect(SMGridViewLayoutSectionGetRect(_layout, index));
+}
+
+- (void)setRect:(CGRect)rect atIndex:(NSUInteger)index {
+    SMGridViewLayoutSectionSetRect(_layout, index, SMGridViewLayoutRectFromCGRect(rect));
+}
+
+- (SMGridViewItemFlags)flagsAtIndex:(NSUInteger)index {
+    return SMGridViewLayoutSectionGetFlags(_layout, index);
+}
+
+- (void)setFlags:(SMGridViewItemFlags)flags atIndex:(NSUInteger)index {
+    SMGridViewLayoutSectionSetFlags(_layout, index, flags);
+}
+
+- (UIView *)viewAtIndex:(NSUInteger)index {
+    return (UIView *)CFDictionaryGetValue(_views, (const void *)(index + 1));
+}
+
+- (void)setView:(UIView *)view atIndex:(NSUInteger)index {
+    UIView *oldView = [self viewAtIndex:index];
+    if (oldView && oldView != view) {
+        CFDictionaryRemoveValue(_viewRows, oldView);
+    }
+    if (view) {
+        CFDictionarySetValue(_views, (const void *)(index + 1), view);
+        CFDictionarySetValue(_viewRows, view, (const void *)(index + 1));
+    } else {
+        CFDictionaryRemoveValue(_views, (const void *)(index + 1));
+    }
+}
+
+- (NSUInteger)indexOfView:(UIView *)view {
+    NSUInteger row = (NSUInteger)CFDictionaryGetValue(_viewRows, view);
+    return row > 0 ? row - 1 : NSNotFound;
+}
+
+- (NSUInteger)viewCount {
+    return CFDictionaryGetCount(_views);
+}
+
+- (void)enumerateViewsUsingBlock:(void (^)(NSUInteger index, UIView *view, BOOL *stop))block {
+    CFIndex viewCount = CFDictionaryGetCount(_views);
+    if (viewCount == 0) {
+        return;
+    }
+    // Work on a copy, block is allowed to queue views
+    const void **keys = malloc(viewCount * sizeof(void *));
+    const void **values = malloc(viewCount * sizeof(void *));
+    CFDictionaryGetKeysAndValues(_views, keys, values);
+    BOOL stop = NO;
+    for (CFIndex i = 0; i < viewCount && !stop; i++) {
+        block((NSUInteger)keys[i] - 1, (UIView *)values[i], &stop);
+    }
+    free(keys);
+    free(values);
+}
+
+static void SMGridViewSectionEnumerateItem(size_t index, void *context, bool *stop) {
+    void (^block)(NSUInteger index, BOOL *stop) = (void (^)(NSUInteger, BOOL *))context;
+    BOOL blockStop = NO;
+    block(index, &blockStop);
+    *stop = blockStop;
+}
+
+- (void)enumerateItemsFrom:(CGFloat)start to:(CGFloat)end vertical:(BOOL)vertical usingBlock:(void (^)(NSUInteger index, BOOL *stop))block {
+    SMGridViewLayoutSectionEnumerateItems(_layout, start, end, vertical, SMGridViewSectionEnumerateItem, (void *)block);
+}
+
+- (void)resetPositionsWithRows:(NSUInteger)rows value:(CGFloat)value {
+    SMGridViewLayoutSectionResetPositions(_layout, rows, value);
+}
+
+- (void)setPosition:(CGFloat)value atRow:(NSUInteger)row {
+    SMGridViewLayoutSectionSetPosition(_layout, row, value);
+}
+
+- (void)extendPositionsToRows:(NSUInteger)rows value:(CGFloat)value {
+    SMGridViewLayoutSectionExtendPositions(_layout, rows, value);
+}
+
+- (void)saveCheckpointAtIndex:(NSUInteger)index {
+    SMGridViewLayoutSectionSaveCheckpoint(_layout, index);
+}
+
+- (NSUInteger)restoreCheckpointBeforeIndex:(NSUInteger)index {
+    size_t start = SMGridViewLayoutSectionRestoreCheckpoint(_layout, index);
+    return start == SMGridViewLayoutNotFound ? NSNotFound : start;
+}
+
+- (void)shiftBy:(CGFloat)delta vertical:(BOOL)vertical {
+    SMGridViewLayoutSectionShift(_layout, delta, vertical);
+}
+
+@end
+
+
+// One insert, delete or move end of a batch, sorted by indexPath before being applied
+typedef struct {
+    NSInteger section;
+    NSInteger row;
+    NSInteger move;
+} SMGridViewBatchOp;
+
+static int SMGridViewBatchOpCompare(const void *op1, const void *op2) {
+    const SMGridViewBatchOp *o1 = op1;
+    const SMGridViewBatchOp *o2 = op2;
+    if (o1->section != o2->section) {
+        return o1->section < o2->section ? -1 : 1;
+    }
+    return o1->row < o2->row ? -1 : (o1->row > o2->row ? 1 : 0);
+}
+
+typedef struct {
+    NSUInteger oldCount;
+    NSUInteger newCount;
+    NSUInteger oldIndex;
+} SMGridViewDiffEntry;
+
+// Heckel's diff: identifiers appearing once in each list are matched, then matches spread to equal neighbours.
+// Unmatched items are -1. Matched items that keep their order (the longest increasing run of old indexes)
+// get NSNotFound in newToOld, the rest keep their old index and are moves.
+// Matching is linear, picking the items that stay is O(n log n) in the matched items, for the fewest moves
+static void SMGridViewDiffMatch(NSArray *oldItems, NSArray *newItems, NSInteger *oldToNew, NSInteger *newToOld) {
+    NSUInteger oldCount = oldItems.count;
+    NSUInteger newCount = newItems.count;
+    SMGridViewDiffEntry *entries = calloc(MAX(oldCount + newCount, 1), sizeof(SMGridViewDiffEntry));
+    NSUInteger entryCount = 0;
+    // Identifier to its entry index + 1
+    CFMutableDictionaryRef table = CFDictionaryCreateMutable(NULL, newCount, &kCFTypeDictionaryKeyCallBacks, NULL);
+    NSUInteger *newEntries = malloc(MAX(newCount, 1) * sizeof(NSUInteger));
+    for (NSUInteger i = 0; i < newCount; i++) {
+        id identifier = [newItems objectAtIndex:i];
+        NSUInteger entry = (NSUInteger)CFDictionaryGetValue(table, identifier);
+        if (entry == 0) {
+            entry = ++entryCount;
+            CFDictionarySetValue(table, identifier, (const void *)entry);
+        }
+        entries[entry - 1].newCount++;
+        newEntries[i] = entry - 1;
+        newToOld[i] = -1;
+    }
+    for (NSUInteger i = 0; i < oldCount; i++) {
+        id identifier = [oldItems objectAtIndex:i];
+        NSUInteger entry = (NSUInteger)CFDictionaryGetValue(table, identifier);
+        if (entry == 0) {
+            entry = ++entryCount;
+            CFDictionarySetValue(table, identifier, (const void *)entry);
+        }
+        entries[entry - 1].oldCount++;
+        entries[entry - 1].oldIndex = i;
+        oldToNew[i] = -1;
+    }
+    CFRelease(table);
+
+    for (NSUInteger i = 0; i < newCount; i++) {
+        SMGridViewDiffEntry entry = entries[newEntries[i]];
+        if (entry.oldCount == 1 && entry.newCount == 1) {
+            newToOld[i] = entry.oldIndex;
+            oldToNew[entry.oldIndex] = i;
+        }
+    }
+    free(newEntries);
+    free(entries);
+    for (NSUInteger i = 0; i + 1 < newCount; i++) {
+        NSInteger j = newToOld[i];
+        if (j >= 0 && j + 1 < oldCount && newToOld[i + 1] < 0 && oldToNew[j + 1] < 0 && [[newItems objectAtIndex:i + 1] isEqual:[oldItems objectAtIndex:j + 1]]) {
+            newToOld[i + 1] = j + 1;
+            oldToNew[j + 1] = i + 1;
+        }
+    }
+    for (NSUInteger i = newCount; i > 1; i--) {
+        NSInteger j = newToOld[i - 1];
+        if (j > 0 && newToOld[i - 2] < 0 && oldToNew[j - 1] < 0 && [[newItems objectAtIndex:i - 2] isEqual:[oldItems objectAtIndex:j - 1]]) {
+            newToOld[i - 2] = j - 1;
+            oldToNew[j - 1] = i - 2;
+        }
+    }
+
+    // Longest increasing subsequence of old indexes in new order, those items stay and the rest move.
+    // Patience sorting with a binary search per item, O(n log n)
+    NSUInteger *tails = malloc(MAX(newCount, 1) * sizeof(NSUInteger));
+    NSInteger *previous = malloc(MAX(newCount, 1) * sizeof(NSInteger));
+    NSUInteger length = 0;
+    for (NSUInteger i = 0; i < newCount; i++) {
+        if (newToOld[i] < 0) {
+            continue;
+        }
+        NSUInteger low = 0;
+        NSUInteger high = length;
+        while (low < high) {
+            NSUInteger mid = (low + high) / 2;
+            if (newToOld[tails[mid]] < newToOld[i]) {
+                low = mid + 1;
+            } else {
+                high = mid;
+            }
+        }
+        previous[i] = low > 0 ? tails[low - 1] : -1;
+        tails[low] = i;
+        length = MAX(length, low + 1);
+    }
+    for (NSInteger i = length > 0 ? (NSInteger)tails[length - 1] : -1; i >= 0; i = previous[i]) {
+        newToOld[i] = NSNotFound;
+    }
+    free(tails);
+    free(previous);
+}
+
+// An item that keeps its view and size while moving
+typedef struct {
+    CGRect rect;
+    SMGridViewItemFlags flags;
+    UIView *view;
+    NSInteger section;
+    BOOL valid;
+    // Set when the destination took it, otherwise its view goes away like a deleted one
+    BOOL placed;
+} SMGridViewMovedItem;
+
+
+/**
+ Changes collected inside [SMGridView performBatchUpdates:completion:]
+ */
+@interface SMGridViewBatch : NSObject
+
+@property (nonatomic, readonly) NSMutableArray *insertedIndexPaths;
+@property (nonatomic, readonly) NSMutableArray *deletedIndexPaths;
+@property (nonatomic, readonly) NSMutableArray *movedFromIndexPaths;
+@property (nonatomic, readonly) NSMutableArray *movedToIndexPaths;
+@property (nonatomic, readonly) NSMutableIndexSet *reloadedSections;
+// Items kept by the batch whose content changed, with their indexPath after it. Their view is asked again
+@property (nonatomic, readonly) NSMutableArray *reloadedIndexPaths;
+// Set when content changes are unknown, every kept item with a view is asked again
+@property (nonatomic, assign) BOOL reloadsVisibleItems;
+@property (nonatomic, readonly) NSMutableArray *completions;
+
+// Adds the deletes, inserts and moves that turn oldIdentifiers into newIdentifiers. Kept items whose token
+// changed from oldTokens to newTokens are added to reloadedIndexPaths. Tokens can be nil
+- (void)addChangesFromIdentifiers:(NSArray *)oldIdentifiers toIdentifiers:(NSArray *)newIdentifiers
+                        oldTokens:(NSArray *)oldTokens newTokens:(NSArray *)newTokens inSection:(NSInteger)section;
+
+@end
+
+
+@implementation SMGridViewBatch
+
+@synthesize insertedIndexPaths = _insertedIndexPaths;
+@synthesize deletedIndexPaths = _deletedIndexPaths;
+@synthesize movedFromIndexPaths = _movedFromIndexPaths;
+@synthesize movedToIndexPaths = _movedToIndexPaths;
+@synthesize reloadedSections = _reloadedSections;
+@synthesize reloadedIndexPaths = _reloadedIndexPaths;
+@synthesize reloadsVisibleItems = _reloadsVisibleItems;
+@synthesize completions = _completions;
+
+- (id)init {
+    self = [super init];
+    if (self) {
+        _insertedIndexPaths = [[NSMutableArray alloc] init];
+        _deletedIndexPaths = [[NSMutableArray alloc] init];
+        _movedFromIndexPaths = [[NSMutableArray alloc] init];
+        _movedToIndexPaths = [[NSMutableArray alloc] init];
+        _reloadedSections = [[NSMutableIndexSet alloc] init];
+        _reloadedIndexPaths = [[NSMutableArray alloc] init];
+        _completions = [[NSMutableArray alloc] init];
+    }
+    return self;
+}
+
+- (void)dealloc {
+    [_insertedIndexPaths release];
+    [_deletedIndexPaths release];
+    [_movedFromIndexPaths release];
+    [_movedToIndexPaths release];
+    [_reloadedSections release];
+    [_reloadedIndexPaths release];
+    [_completions release];
+    [super dealloc];
+}
+
+- (void)addReloadFromToken:(NSArray *)oldTokens index:(NSUInteger)oldIndex toToken:(NSArray *)newTokens index:(NSUInteger)newIndex inSection:(NSInteger)section {
+    if (oldTokens && ![[oldTokens objectAtIndex:oldIndex] isEqual:[newTokens objectAtIndex:newIndex]]) {
+        [_reloadedIndexPaths addObject:[NSIndexPath indexPathForRow:newIndex inSection:section]];
+    }
+}
+
+- (void)addChangesFromIdentifiers:(NSArray *)oldIdentifiers toIdentifiers:(NSArray *)newIdentifiers
+                        oldTokens:(NSArray *)oldTokens newTokens:(NSArray *)newTokens inSection:(NSInteger)section {
+    NSUInteger oldCount = oldIdentifiers.count;
+    NSUInteger newCount = newIdentifiers.count;
+    if (!oldTokens || !newTokens || oldTokens.count != oldCount || newTokens.count != newCount) {
+        oldTokens = nil;
+    }
+    // Snapshots usually change in a few places, the common ends are skipped
+    NSUInteger prefix = 0;
+    while (prefix < oldCount && prefix < newCount && [[oldIdentifiers objectAtIndex:prefix] isEqual:[newIdentifiers objectAtIndex:prefix]]) {
+        prefix++;
+    }
+    NSUInteger suffix = 0;
+    while (suffix < oldCount - prefix && suffix < newCount - prefix && [[oldIdentifiers objectAtIndex:oldCount - suffix - 1] isEqual:[newIdentifiers objectAtIndex:newCount - suffix - 1]]) {
+        suffix++;
+    }
+    for (NSUInteger i = 0; i < prefix; i++) {
+        [self addReloadFromToken:oldTokens index:i toToken:newTokens index:i inSection:section];
+    }
+    for (NSUInteger i = 1; i <= suffix; i++) {
+        [self addReloadFromToken:oldTokens index:oldCount - i toToken:newTokens index:newCount - i inSection:section];
+    }
+    NSArray *oldItems = [oldIdentifiers subarrayWithRange:NSMakeRange(prefix, oldCount - prefix - suffix)];
+    NSArray *newItems = [newIdentifiers subarrayWithRange:NSMakeRange(prefix, newCount - prefix - suffix)];
+    NSUInteger count = oldItems.count + newItems.count;
+    if (count == 0) {
+        return;
+    }
+    NSInteger *newToOld = malloc(count * sizeof(NSInteger));
+    NSInteger *oldToNew = newToOld + newItems.count;
+    SMGridViewDiffMatch(oldItems, newItems, oldToNew, newToOld);
+
+    for (NSUInteger i = 0; i < oldItems.count; i++) {
+        if (oldToNew[i] < 0) {
+            [_deletedIndexPaths addObject:[NSIndexPath indexPathForRow:prefix + i inSection:section]];
+        } else {
+            // Items that stay have NSNotFound in newToOld, oldToNew still has their new index
+            [self addReloadFromToken:oldTokens index:prefix + i toToken:newTokens index:prefix + oldToNew[i] inSection:section];
+        }
+    }
+    for (NSUInteger i = 0; i < newItems.count; i++) {
+        if (newToOld[i] < 0) {
+            [_insertedIndexPaths addObject:[NSIndexPath indexPathForRow:prefix + i inSection:section]];
+        } else if (newToOld[i] != NSNotFound) {
+            [_movedFromIndexPaths addObject:[NSIndexPath indexPathForRow:prefix + newToOld[i] inSection:section]];
+            [_movedToIndexPaths addObject:[NSIndexPath indexPathForRow:prefix + i inSection:section]];
+        }
+    }
+    free(newToOld);
+}
+
+@end
+
+
+/**
+ Reusable views of one class. Views are pushed and popped from the end
+ */
+@interface SMGridViewReusePool : NSObject
+
+@property (nonatomic, readonly) NSMutableArray *views;
+@property (nonatomic, assign) NSUInteger maxCount;
+// Set with setMaxReusableViews:forClass:, maxReusableViewsPerClass doesn't change it
+@property (nonatomic, assign) BOOL customMaxCount;
+
+@end
+
+
+@implementation SMGridViewReusePool
+
+@synthesize views = _views;
+@synthesize maxCount = _maxCount;
+@synthesize customMaxCount = _customMaxCount;
+
+- (id)init {
+    self = [super init];
+    if (self) {
+        _views = [[NSMutableArray alloc] init];
+    }
+    return self;
+}
+
+- (void)dealloc {
+    [_views release];
+    [super dealloc];
 }
 
 @end
@@ -106,23 +793,68 @@ typedef NSUInteger SMGridViewSortAnimSpeed;
 ////////////////////////////////////////////////////////////////////////////////////////////
 @interface SMGridView() {
     CGPoint _lastOffset;
-    SMGridViewSortAnimSpeed _draggingSpeed;
+    // Edge auto scroll while sorting, driven by dragDisplayLink
+    CFTimeInterval _dragScrollStartTime;
+    CFTimeInterval _dragScrollLastTime;
+    BOOL _dragScrollingFrame;
+    BOOL _dragTargetDirty;
     BOOL _loadingViews;
+    // Main axis range covered by the last load pass. Only valid while item rects and loaded views are unchanged
+    CGFloat _loadWindowStart;
+    CGFloat _loadWindowEnd;
+    CGFloat _loadWindowCrossSize;
+    BOOL _loadWindowValid;
+    // Class of the last queued view, dequeReusableView tries its pool first
+    Class _lastQueuedClass;
+    // Placeholders are kept apart, dequeReusableView must never give one to the dataSource as a cell
+    SMGridViewReusePool *_placeholderPool;
+    // Class -> number of views its pool should have, filled in idle run loop passes
+    CFMutableDictionaryRef _prewarmCounts;
+    BOOL _prewarmScheduled;
+    CFTimeInterval _lastOffsetTime;
+    // View -> SMGridViewSection holding it, the section knows the row. Sections are retained so an
+    // entry left behind (a view moved or removed by a batch) can't point to a released one
+    CFMutableDictionaryRef _viewSections;
+    // Start of the current load pass, to know when loadBudget is spent
+    CFAbsoluteTime _loadPassStart;
+    BOOL _deferredLoadScheduled;
+    // Bounds of every section, kept non decreasing so they can be binary searched. Rebuilt after layout changes
+    SMGridViewLayoutBounds *_sectionBounds;
+    NSUInteger _sectionBoundsCount;
+    BOOL _sectionBoundsValid;
+    // Ring of traceCapacity events, NULL when not tracing. _traceNext is where the next one goes
+    SMGridViewTraceEvent *_traceEvents;
+    NSUInteger _traceCapacity;
+    NSUInteger _traceNext;
+    NSUInteger _traceCount;
 }
 
 - (BOOL)loaderEnabled;
 - (void)handleLoaderDisplay:(CGRect)rect;
 - (void)updateEmptyView;
 - (CGFloat)findMaxValue;
-
-@property (nonatomic, retain) NSTimer *dragAnimTimer;
+- (CGFloat)findMaxValueInSection:(NSInteger)section;
+- (CGFloat)findMinValueInSection:(NSInteger)section;
+- (SMGridViewSection *)itemsInSection:(NSInteger)section;
+- (NSInteger)numberOfSections;
+- (NSInteger)numberOfRowsInSection:(NSInteger)section;
+- (NSInteger)numberOfItemsInSection:(NSInteger)section;
+- (void)addSorting:(UIView *)view;
+- (void)adjustDraggingViewToFit;
+- (CGPoint)adjustDragPointToFit:(CGPoint)point controlView:(UIControl *)controlView;
+- (BOOL)calculatePositionsDragTimer;
+- (void)changePageTimer:(BOOL)next interval:(NSTimeInterval)interval;
+- (void)stopDragScroll;
+
+@property (nonatomic, retain) CADisplayLink *dragDisplayLink;
 @property (nonatomic, retain) NSTimer *dragStartAnimTimer;
 @property (nonatomic, retain) NSTimer *dragPageAnimTimer;
 @property (nonatomic, retain) UIView *draggingView;
-@property (nonatomic, retain) NSMutableArray *posArray;
-@property (nonatomic, retain) NSMutableArray *posArrays;
 @property (nonatomic, retain) NSIndexPath *removingIndexPath;
 @property (nonatomic, retain) NSIndexPath *addingIndexPath;
+@property (nonatomic, retain) SMGridViewBatch *batch;
+@property (nonatomic, retain) NSMutableArray *pendingUpdates;
+@property (nonatomic, retain) NSMutableSet *prefetchedIndexPaths;
 
 @end
 
@@ -131,14 +863,19 @@ typedef NSUInteger SMGridViewSortAnimSpeed;
 
 @synthesize dataSource = _dataSource;
 @synthesize gridDelegate = _gridDelegate;
-@synthesize posArray = _posArray;
-@synthesize posArrays = _posArrays;
 @synthesize removingIndexPath = _removingIndexPath;
 @synthesize addingIndexPath = _addingIndexPath;
+@synthesize batch = _batch;
+@synthesize pendingUpdates = _pendingUpdates;
+@synthesize prefetchedIndexPaths = _prefetchedIndexPaths;
 @synthesize numberOfRows;
 @synthesize padding  = _padding;
 
-@synthesize deltaLoad;
+@synthesize minDeltaLoad = _minDeltaLoad;
+@synthesize maxDeltaLoad = _maxDeltaLoad;
+@synthesize lastLoadRect = _lastLoadRect;
+@synthesize scrollVelocity = _scrollVelocity;
+@synthesize loadBudget = _loadBudget;
 @synthesize deltaLoaderView;
 @synthesize pagesToPreload;
 @synthesize vertical = _vertical;
@@ -149,23 +886,34 @@ typedef NSUInteger SMGridViewSortAnimSpeed;
 @synthesize emptyView = _emptyView;
 @synthesize enableSort = _enableSort;
 @synthesize dragMinDistance = _dragMinDistance;
-@synthesize dragAnimTimer = _dragAnimTimer;
+@synthesize dragDisplayLink = _dragDisplayLink;
 @synthesize dragStartAnimTimer = _dragStartAnimTimer;
 @synthesize dragPageAnimTimer = _dragPageAnimTimer;
 @synthesize draggingPoint = _draggingPoint;
 @synthesize draggingView = _draggingView;
 @synthesize stickyHeaders = _stickyHeaders;
 @synthesize currentSection = _currentSection;
+@synthesize lastLoadCreatedViews = _lastLoadCreatedViews;
+@synthesize lastLoadRecycledViews = _lastLoadRecycledViews;
+@synthesize maxReusableViewsPerClass = _maxReusableViewsPerClass;
+@synthesize metrics = _metrics;
 
 #pragma mark - Life flow
 
 - (void)setup {
     self.delegate = self;
-    _reusableViews = [[NSMutableArray alloc] init];
+    // Keys are classes, not retained
+    _reusePools = CFDictionaryCreateMutable(kCFAllocatorDefault, 0, NULL, &kCFTypeDictionaryValueCallBacks);
+    _maxReusableViewsPerClass = kSMdefaultMaxReusableViewsPerClass;
+    _placeholderPool = [[SMGridViewReusePool alloc] init];
+    _placeholderPool.maxCount = _maxReusableViewsPerClass;
+    _prewarmCounts = CFDictionaryCreateMutable(kCFAllocatorDefault, 0, NULL, NULL);
+    _viewSections = CFDictionaryCreateMutable(kCFAllocatorDefault, 0, NULL, &kCFTypeDictionaryValueCallBacks);
     self.numberOfRows = 1;
     self.clipsToBounds = YES;
     self.padding = kSMTVdefaultPadding;
-    self.deltaLoad = kSMTVdefaultDeltaLoad;
+    _minDeltaLoad = kSMTVdefaultMinDeltaLoad;
+    _maxDeltaLoad = kSMTVdefaultMaxDeltaLoad;
     self.deltaLoaderView = kSMTVdefaultDeltaLoad;
     self.pagesToPreload = kSMTVdefaultPagesToPreload;
     _enableSort = NO;
@@ -175,7 +923,6 @@ typedef NSUInteger SMGridViewSortAnimSpeed;
     _draggingOrigItemsIndex = -1;
     _draggingSection = -1;
     _sortWaitBeforeAnimate = .05;
-    _bucketItems = [[NSMutableArray alloc] init];
 }
 
 - (id)initWithCoder:(NSCoder *)aDecoder {
@@ -203,62 +950,425 @@ typedef NSUInteger SMGridViewSortAnimSpeed;
 }
 
 - (void)dealloc {
-    [_dragAnimTimer invalidate];
-    [_dragAnimTimer release];
+    [_dragDisplayLink invalidate];
+    [_dragDisplayLink release];
     [_dragStartAnimTimer invalidate];
     [_dragStartAnimTimer release];
     [_dragPageAnimTimer invalidate];
     [_dragPageAnimTimer release];
-    [_items release];
-    [_reusableViews release];
+    [_sections release];
+    CFRelease(_reusePools);
+    [_placeholderPool release];
+    CFRelease(_prewarmCounts);
+    CFRelease(_viewSections);
+    free(_sectionBounds);
+    free(_traceEvents);
     [_loaderView release];
     [_emptyView release];
     [_draggingView release];
     [_removingIndexPath release];
     [_addingIndexPath release];
+    [_batch release];
+    [_pendingUpdates release];
+    [_prefetchedIndexPaths release];
     _draggingView = nil;
-    
+
     [super dealloc];
 }
 
 
+#pragma mark - Item store
+
+- (SMGridViewSection *)itemsInSection:(NSInteger)section {
+    if (section >= 0 && section < _sections.count) {
+        return [_sections objectAtIndex:section];
+    } else {
+        return nil;
+    }
+}
+
+- (BOOL)isValidItem:(SMGridViewItemRef)item {
+    SMGridViewSection *sectionItems = [self itemsInSection:item.section];
+    if (!sectionItems) {
+        return NO;
+    }
+    return item.header || (item.row >= 0 && item.row < sectionItems.count);
+}
+
+- (CGRect)rectForItem:(SMGridViewItemRef)item {
+    if (![self isValidItem:item]) {
+        return CGRectZero;
+    }
+    SMGridViewSection *sectionItems = [self itemsInSection:item.section];
+    return item.header ? sectionItems.headerRect : [sectionItems rectAtIndex:item.row];
+}
+
+- (UIView *)viewForItem:(SMGridViewItemRef)item {
+    if (![self isValidItem:item]) {
+        return nil;
+    }
+    SMGridViewSection *sectionItems = [self itemsInSection:item.section];
+    return item.header ? sectionItems.headerView : [sectionItems viewAtIndex:item.row];
+}
+
+- (void)setView:(UIView *)view forItem:(SMGridViewItemRef)item {
+    if (![self isValidItem:item]) {
+        return;
+    }
+    SMGridViewSection *sectionItems = [self itemsInSection:item.section];
+    UIView *oldView = item.header ? sectionItems.headerView : [sectionItems viewAtIndex:item.row];
+    if (oldView && oldView != view) {
+        CFDictionaryRemoveValue(_viewSections, oldView);
+    }
+    if (view) {
+        CFDictionarySetValue(_viewSections, view, sectionItems);
+    }
+    if (item.header) {
+        sectionItems.headerView = view;
+    } else {
+        [sectionItems setView:view atIndex:item.row];
+    }
+}
+
+- (BOOL)isItemToAdd:(SMGridViewItemRef)item {
+    if (item.header || ![self isValidItem:item]) {
+        return NO;
+    }
+    return ([[self itemsInSection:item.section] flagsAtIndex:item.row] & SMGridViewItemFlagToAdd) != 0;
+}
+
+- (void)setToAdd:(BOOL)toAdd forItem:(SMGridViewItemRef)item {
+    if (item.header || ![self isValidItem:item]) {
+        return;
+    }
+    SMGridViewSection *sectionItems = [self itemsInSection:item.section];
+    SMGridViewItemFlags flags = [sectionItems flagsAtIndex:item.row];
+    flags = toAdd ? (flags | SMGridViewItemFlagToAdd) : (flags & ~SMGridViewItemFlagToAdd);
+    [sectionItems setFlags:flags atIndex:item.row];
+}
+
+- (BOOL)isPlaceholderItem:(SMGridViewItemRef)item {
+    if (item.header || ![self isValidItem:item]) {
+        return NO;
+    }
+    return ([[self itemsInSection:item.section] flagsAtIndex:item.row] & SMGridViewItemFlagPlaceholder) != 0;
+}
+
+- (void)setPlaceholder:(BOOL)placeholder forItem:(SMGridViewItemRef)item {
+    if (item.header || ![self isValidItem:item]) {
+        return;
+    }
+    SMGridViewSection *sectionItems = [self itemsInSection:item.section];
+    SMGridViewItemFlags flags = [sectionItems flagsAtIndex:item.row];
+    flags = placeholder ? (flags | SMGridViewItemFlagPlaceholder) : (flags & ~SMGridViewItemFlagPlaceholder);
+    [sectionItems setFlags:flags atIndex:item.row];
+}
+
+- (NSIndexPath *)indexPathForItem:(SMGridViewItemRef)item {
+    return [NSIndexPath indexPathForRow:item.header ? 0 : item.row inSection:item.section];
+}
+
+- (SMGridViewItemRef)itemForIndexPath:(NSIndexPath *)indexPath {
+    return SMGridViewItemRefMake(indexPath.section, indexPath.row);
+}
+
+- (CGRect)headerRectInSection:(NSInteger)section {
+    SMGridViewSection *sectionItems = [self itemsInSection:section];
+    return sectionItems ? sectionItems.headerRect : CGRectNull;
+}
+
+- (void)loopVisibleItems:(void (^)(SMGridViewItemRef item, UIView *view, BOOL *stop))block {
+    __block BOOL stop = NO;
+    for (int section = 0; section < _sections.count && !stop; section++) {
+        SMGridViewSection *sectionItems = [_sections objectAtIndex:section];
+        [sectionItems enumerateViewsUsingBlock:^(NSUInteger index, UIView *view, BOOL *stopViews) {
+            block(SMGridViewItemRefMake(section, index), view, &stop);
+            *stopViews = stop;
+        }];
+        if (sectionItems.headerView && !stop) {
+            block(SMGridViewHeaderRefMake(section), sectionItems.headerView, &stop);
+        }
+    }
+}
+
+- (void)addMissingSections:(NSInteger)numberOfSections {
+    if (!_sections) {
+        _sections = [[NSMutableArray alloc] init];
+    }
+    while (_sections.count < numberOfSections) {
+        SMGridViewSection *sectionItems = [[SMGridViewSection alloc] init];
+        sectionItems.section = _sections.count;
+        [_sections addObject:sectionItems];
+        [sectionItems release];
+    }
+}
+
+
 # pragma mark - Reuse views
 
 - (UIView *)dequeReusableView {
     return [self dequeReusableViewOfClass:0];
 }
 
+- (SMGridViewReusePool *)reusePoolForClass:(Class)class create:(BOOL)create {
+    SMGridViewReusePool *pool = (SMGridViewReusePool *)CFDictionaryGetValue(_reusePools, class);
+    if (!pool && create) {
+        pool = [[SMGridViewReusePool alloc] init];
+        pool.maxCount = _maxReusableViewsPerClass;
+        CFDictionarySetValue(_reusePools, class, pool);
+        [pool release];
+    }
+    return pool;
+}
+
+- (void)enumerateReusePools:(void (^)(SMGridViewReusePool *pool))block {
+    CFIndex count = CFDictionaryGetCount(_reusePools);
+    if (count == 0) {
+        return;
+    }
+    const void **values = malloc(count * sizeof(void *));
+    CFDictionaryGetKeysAndValues(_reusePools, NULL, values);
+    for (CFIndex i = 0; i < count; i++) {
+        block((SMGridViewReusePool *)values[i]);
+    }
+    free(values);
+}
+
 - (UIView *)dequeReusableViewOfClass:(Class)class {
-    if (_reusableViews.count > 0) {
-        for (UIView *view in _reusableViews) {
-            if ([view isMemberOfClass:class] || !class) {
-                [[view retain] autorelease];
-                [_reusableViews removeObject:view];
-                view.alpha = 1.0;
-                return view;
+    SMGridViewReusePool *pool = [self reusePoolForClass:class ? class : _lastQueuedClass create:NO];
+    if (!class && pool.views.count == 0) {
+        // Any class is fine, take the first pool with views
+        __block SMGridViewReusePool *found = nil;
+        [self enumerateReusePools:^(SMGridViewReusePool *candidate) {
+            if (!found && candidate.views.count > 0) {
+                found = candidate;
             }
+        }];
+        pool = found;
+    }
+    UIView *view = [pool.views lastObject];
+    if (!view) {
+        _metrics.reuseMisses++;
+        return nil;
+    }
+    _metrics.reuseHits++;
+    [[view retain] autorelease];
+    [pool.views removeLastObject];
+    view.alpha = 1.0;
+    return view;
+}
+
+- (UIView *)dequeReusablePlaceholderView {
+    UIView *view = [[[_placeholderPool.views lastObject] retain] autorelease];
+    if (view) {
+        [_placeholderPool.views removeLastObject];
+        view.alpha = 1.0;
+    }
+    return view;
+}
+
+- (void)setMaxReusableViews:(NSUInteger)maxCount forClass:(Class)class {
+    SMGridViewReusePool *pool = [self reusePoolForClass:class create:YES];
+    pool.maxCount = maxCount;
+    pool.customMaxCount = YES;
+    while (pool.views.count > maxCount) {
+        [pool.views removeLastObject];
+        _metrics.reuseEvictions++;
+    }
+}
+
+- (void)setMaxReusableViewsPerClass:(NSUInteger)maxReusableViewsPerClass {
+    _maxReusableViewsPerClass = maxReusableViewsPerClass;
+    _placeholderPool.maxCount = maxReusableViewsPerClass;
+    while (_placeholderPool.views.count > maxReusableViewsPerClass) {
+        [_placeholderPool.views removeLastObject];
+    }
+    [self enumerateReusePools:^(SMGridViewReusePool *pool) {
+        if (pool.customMaxCount) {
+            return;
+        }
+        pool.maxCount = maxReusableViewsPerClass;
+        while (pool.views.count > maxReusableViewsPerClass) {
+            [pool.views removeLastObject];
+            _metrics.reuseEvictions++;
         }
+    }];
+}
+
+- (NSUInteger)numberOfReusableViewsOfClass:(Class)class {
+    return [self reusePoolForClass:class create:NO].views.count;
+}
+
+- (NSUInteger)numberOfReusableViews {
+    __block NSUInteger count = 0;
+    [self enumerateReusePools:^(SMGridViewReusePool *pool) {
+        count += pool.views.count;
+    }];
+    return count;
+}
+
+- (void)prewarmReusableViewsOfClass:(Class)clazz count:(NSUInteger)count {
+    if (!clazz) {
+        return;
     }
-    return nil;
+    CFDictionarySetValue(_prewarmCounts, clazz, (const void *)count);
+    [self schedulePrewarm];
 }
 
-- (void)queView:(SMGridViewItem *)item {
-    UIView *view = item.view;
-    if (view == _draggingView) {
+- (void)schedulePrewarm {
+    if (_prewarmScheduled) {
         return;
     }
-    if (!item.header) {
+    _prewarmScheduled = YES;
+    // Default mode only, so nothing is created while the user is scrolling
+    [self performSelector:@selector(prewarmSlice) withObject:nil afterDelay:0 inModes:[NSArray arrayWithObject:NSDefaultRunLoopMode]];
+}
+
+- (UIView *)prewarmViewOfClass:(Class)clazz {
+    if ([_dataSource respondsToSelector:@selector(smGridView:viewForPrewarmingClass:)]) {
+        return [_dataSource smGridView:self viewForPrewarmingClass:clazz];
+    }
+    return [[[clazz alloc] initWithFrame:CGRectZero] autorelease];
+}
+
+- (void)prewarmSlice {
+    _prewarmScheduled = NO;
+    CFIndex count = CFDictionaryGetCount(_prewarmCounts);
+    if (count == 0) {
+        return;
+    }
+    CFAbsoluteTime start = CFAbsoluteTimeGetCurrent();
+    const void **keys = malloc(count * sizeof(void *));
+    const void **values = malloc(count * sizeof(void *));
+    CFDictionaryGetKeysAndValues(_prewarmCounts, keys, values);
+    for (CFIndex i = 0; i < count; i++) {
+        Class clazz = (Class)keys[i];
+        SMGridViewReusePool *pool = [self reusePoolForClass:clazz create:YES];
+        NSUInteger target = MIN((NSUInteger)values[i], pool.maxCount);
+        while (pool.views.count < target && CFAbsoluteTimeGetCurrent() - start < kSMdefaultPrewarmSliceDuration) {
+            UIView *view = [self prewarmViewOfClass:clazz];
+            if (!view) {
+                target = 0;
+                break;
+            }
+            [pool.views addObject:view];
+            _lastQueuedClass = clazz;
+        }
+        if (pool.views.count >= target) {
+            CFDictionaryRemoveValue(_prewarmCounts, clazz);
+        }
+    }
+    free(keys);
+    free(values);
+    if (CFDictionaryGetCount(_prewarmCounts) > 0) {
+        [self schedulePrewarm];
+    }
+}
+
+- (void)resetReuseStats {
+    _metrics.reuseHits = 0;
+    _metrics.reuseMisses = 0;
+    _metrics.reuseEvictions = 0;
+}
+
+#pragma mark - Metrics
+
+- (NSUInteger)reuseHits {
+    return _metrics.reuseHits;
+}
+
+- (NSUInteger)reuseMisses {
+    return _metrics.reuseMisses;
+}
+
+- (NSUInteger)reuseEvictions {
+    return _metrics.reuseEvictions;
+}
+
+- (void)resetMetrics {
+    memset(&_metrics, 0, sizeof(SMGridViewMetrics));
+}
+
+#pragma mark - Tracing
+
+- (NSUInteger)traceCapacity {
+    return _traceCapacity;
+}
+
+- (void)setTraceCapacity:(NSUInteger)traceCapacity {
+    free(_traceEvents);
+    _traceEvents = traceCapacity > 0 ? malloc(traceCapacity * sizeof(SMGridViewTraceEvent)) : NULL;
+    _traceCapacity = traceCapacity;
+    [self clearTrace];
+}
+
+- (void)clearTrace {
+    _traceNext = 0;
+    _traceCount = 0;
+}
+
+// Only called when tracing, call sites check _traceEvents first so it costs a branch otherwise
+- (void)traceSpan:(SMGridViewTraceSpan)span section:(NSInteger)section row:(NSInteger)row start:(CFTimeInterval)start {
+    SMGridViewTraceEvent *event = _traceEvents + _traceNext;
+    event->start = start;
+    event->duration = CACurrentMediaTime() - start;
+    event->section = (int32_t)section;
+    event->row = (int32_t)row;
+    event->span = span;
+    _traceNext = (_traceNext + 1) % _traceCapacity;
+    _traceCount = MIN(_traceCount + 1, _traceCapacity);
+}
+
+- (NSData *)traceJSONData {
+    NSMutableString *json = [NSMutableString stringWithString:@"{\"traceEvents\":["];
+    NSUInteger first = (_traceNext + _traceCapacity - _traceCount) % MAX(_traceCapacity, 1);
+    for (NSUInteger i = 0; i < _traceCount; i++) {
+        SMGridViewTraceEvent *event = _traceEvents + (first + i) % _traceCapacity;
+        // Complete events, timestamps in microseconds
+        [json appendFormat:@"%@{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":1,\"ts\":%.3f,\"dur\":%.3f",
+         i > 0 ? @"," : @"", SMGridViewTraceSpanNames[event->span], event->start * 1000000, event->duration * 1000000];
+        if (event->section >= 0) {
+            [json appendFormat:@",\"args\":{\"section\":%d,\"row\":%d}", event->section, event->row];
+        }
+        [json appendString:@"}"];
+    }
+    [json appendString:@"],\"displayTimeUnit\":\"ms\"}"];
+    return [json dataUsingEncoding:NSUTF8StringEncoding];
+}
+
+- (void)queView:(SMGridViewItemRef)item {
+    UIView *view = [self viewForItem:item];
+    if (!view || view == _draggingView) {
+        return;
+    }
+    if (!item.header && [self isPlaceholderItem:item]) {
+        if (_placeholderPool.views.count < _placeholderPool.maxCount) {
+            [_placeholderPool.views addObject:view];
+        }
+        [self setPlaceholder:NO forItem:item];
+    } else if (!item.header) {
         if ([_dataSource respondsToSelector:@selector(smGridView:willQueueView:)]) {
             [_dataSource performSelector:@selector(smGridView:willQueueView:) withObject:self withObject:view];
         }
-        [_reusableViews addObject:view];
+        SMGridViewReusePool *pool = [self reusePoolForClass:[view class] create:YES];
+        _metrics.viewsQueued++;
+        if (pool.views.count < pool.maxCount) {
+            [pool.views addObject:view];
+            _lastQueuedClass = [view class];
+        } else {
+            _metrics.reuseEvictions++;
+        }
     }
-    item.view = nil;
+    [self setView:nil forItem:item];
     [view removeFromSuperview];
 }
 
 - (void)clearReusableViews {
-    [_reusableViews removeAllObjects];
+    CFDictionaryRemoveAllValues(_prewarmCounts);
+    [_placeholderPool.views removeAllObjects];
+    [self enumerateReusePools:^(SMGridViewReusePool *pool) {
+        [pool.views removeAllObjects];
+    }];
 }
 
 #pragma mark - Show views
@@ -276,9 +1386,9 @@ typedef NSUInteger SMGridViewSortAnimSpeed;
         return indexPath;
     }
     int index = indexPath.row;
-    NSArray *items = [self itemsInSection:_draggingSection];
+    NSInteger count = [self itemsInSection:_draggingSection].count;
 
-    if (index >= _draggingOrigItemsIndex && index < _draggingItemsIndex && index < (items.count-1)) {
+    if (index >= _draggingOrigItemsIndex && index < _draggingItemsIndex && index < count) {
         return [NSIndexPath indexPathForRow:index+1 inSection:indexPath.section];
     }
     if (index <= _draggingOrigItemsIndex && _draggingItemsIndex < _draggingOrigItemsIndex && index > 0 && index >=_draggingItemsIndex) {
@@ -296,105 +1406,113 @@ typedef NSUInteger SMGridViewSortAnimSpeed;
 }
 
 - (UIView *)dataSourceViewForIndexPath:(NSIndexPath *)indexPath {
-    return [_dataSource smGridView:self viewForIndexPath:[self adjustAddIndexPath:indexPath]];
+    CFTimeInterval start = CACurrentMediaTime();
+    UIView *view = [_dataSource smGridView:self viewForIndexPath:[self adjustAddIndexPath:indexPath]];
+    _metrics.viewRequests++;
+    SMGridViewLatencyRecord(&_metrics.viewRequestLatency, start);
+    if (_traceEvents) {
+        [self traceSpan:SMGridViewTraceSpanViewRequest section:indexPath.section row:indexPath.row start:start];
+    }
+    return view;
 }
 
-- (UIView *)dataSourceViewForItem:(SMGridViewItem *)item {
+- (UIView *)dataSourceViewForItem:(SMGridViewItemRef)item {
     if (item.header) {
         if ([_dataSource respondsToSelector:@selector(smGridView:viewForHeaderInSection:)]) {
-            return [_dataSource smGridView:self viewForHeaderInSection:item.indexPath.section];
+            CFTimeInterval start = CACurrentMediaTime();
+            UIView *view = [_dataSource smGridView:self viewForHeaderInSection:item.section];
+            _metrics.viewRequests++;
+            SMGridViewLatencyRecord(&_metrics.viewRequestLatency, start);
+            if (_traceEvents) {
+                [self traceSpan:SMGridViewTraceSpanHeaderViewRequest section:item.section row:-1 start:start];
+            }
+            return view;
         } else {
             return nil;
         }
     } else {
-        return [self dataSourceViewForIndexPath:[self calculateSortDataSourceIndexPath:item.indexPath]];
-    }
-}
-
-- (void)addItemToVisibles:(SMGridViewItem *)item {
-    if (!_visibleItems) {
-        _visibleItems = [[NSMutableArray alloc] init];
+        return [self dataSourceViewForIndexPath:[self calculateSortDataSourceIndexPath:[self indexPathForItem:item]]];
     }
-    [_visibleItems addObject:item];
 }
 
-- (void)removeItemFromVisibles:(SMGridViewItem *)item {
-    [_visibleItems removeObject:item];
-}
-
-- (void)addViewForItem:(SMGridViewItem *)item {
+- (void)addViewForItem:(SMGridViewItemRef)item {
     UIView *view = [self dataSourceViewForItem:item];
 
     CGRect frame = view.frame;
-    CGRect rect = item.rect;
+    CGRect rect = [self rectForItem:item];
     frame.origin.x = rect.origin.x;
     frame.origin.y = rect.origin.y;
     view.frame = frame;
-    
+
     [self addSubview:view];
     if (!item.header) {
         [self adjustNewViewPosition:view];
     }
-    
-    item.view = view;
-    item.view.hidden = item.toAdd;
-    
+
+    [self setView:view forItem:item];
+    view.hidden = [self isItemToAdd:item];
+
     if (!item.header) {
         [self addSorting:view];
     }
-    [self addItemToVisibles:item];
 }
 
-- (BOOL)headerStickyNeedsAdjustment:(SMGridViewItem *)item {
-    if (!item.view) {
+- (BOOL)headerStickyNeedsAdjustment:(SMGridViewItemRef)item {
+    if (![self viewForItem:item]) {
         return NO;
     }
+    CGRect rect = [self rectForItem:item];
     if (self.vertical) {
-        if (self.contentOffset.y > CGRectGetMinY(item.rect)) {
+        if (self.contentOffset.y > CGRectGetMinY(rect)) {
             return YES;
         }
     } else {
-        if (self.contentOffset.x > CGRectGetMinX(item.rect)) {
+        if (self.contentOffset.x > CGRectGetMinX(rect)) {
             return YES;
         }
     }
     return NO;
 }
 
-- (BOOL)isCurrentHeaderItemSticky:(SMGridViewItem *)item {
-    BOOL ret = self.stickyHeaders && item.header && !CGRectIsEmpty(item.rect) && item.indexPath.section == _currentSection && !CGSizeEqualToSize(CGSizeZero, item.rect.size);
-    return ret;
+- (BOOL)isCurrentHeaderItemSticky:(SMGridViewItemRef)item {
+    if (!self.stickyHeaders || !item.header || item.section != _currentSection) {
+        return NO;
+    }
+    CGRect rect = [self rectForItem:item];
+    return !CGRectIsEmpty(rect) && !CGSizeEqualToSize(CGSizeZero, rect.size);
 }
 
 - (CGRect)rectForIndexPath:(NSIndexPath *)indexPath {
-    SMGridViewItem *item = [self itemAtIndexPath:indexPath];
-    return item.rect;
+    [self measureItemsUpToIndexPath:indexPath];
+    return [self rectForItem:[self itemForIndexPath:indexPath]];
 }
 
-- (void)updateRectForItem:(SMGridViewItem *)item {
+- (void)updateRectForItem:(SMGridViewItemRef)item {
+    UIView *view = [self viewForItem:item];
+    CGRect itemRect = [self rectForItem:item];
     if ([self isCurrentHeaderItemSticky:item]) {
-        SMGridViewItem *headerNextItem = [self headerItemInSection:_currentSection+1];
-        if ([self headerStickyNeedsAdjustment:item]) {            
-            CGRect frame = item.rect;
+        CGRect headerNextRect = [self headerRectInSection:_currentSection+1];
+        if ([self headerStickyNeedsAdjustment:item]) {
+            CGRect frame = itemRect;
             if (self.vertical) {
                 frame.origin.y = self.contentOffset.y;
-                if (CGRectIntersectsRect(headerNextItem.rect, frame)) {
-                    frame.origin.y -= CGRectGetMaxY(frame) - CGRectGetMinY(headerNextItem.rect);
+                if (CGRectIntersectsRect(headerNextRect, frame)) {
+                    frame.origin.y -= CGRectGetMaxY(frame) - CGRectGetMinY(headerNextRect);
                 }
             } else {
                 frame.origin.x = self.contentOffset.x;
-                if (CGRectIntersectsRect(headerNextItem.rect, frame)) {
-                    frame.origin.x -= CGRectGetMaxX(frame) - CGRectGetMinX(headerNextItem.rect);
+                if (CGRectIntersectsRect(headerNextRect, frame)) {
+                    frame.origin.x -= CGRectGetMaxX(frame) - CGRectGetMinX(headerNextRect);
                 }
             }
-            item.view.frame = frame;
+            view.frame = frame;
             return;
         }
     }
-    if (item.view && item.view != _draggingView && !CGRectEqualToRect(item.view.frame, item.rect)) {
-        CGRect rect = item.view.frame;
-        rect.origin = item.rect.origin;
-        item.view.frame = rect;
+    if (view && view != _draggingView && !CGRectEqualToRect(view.frame, itemRect)) {
+        CGRect rect = view.frame;
+        rect.origin = itemRect.origin;
+        view.frame = rect;
     }
 }
 
@@ -410,195 +1528,372 @@ typedef NSUInteger SMGridViewSortAnimSpeed;
     }
 }
 
-- (CGRect)calculateLoadRect:(NSInteger)pos delta:(float)delta {
-    if (self.vertical) {
-        return CGRectMake(0, pos - delta, self.frame.size.width, self.frame.size.height + 2*delta);
-    }else {
-        return CGRectMake(pos - delta, 0, self.frame.size.width + 2*delta, self.frame.size.height);
+// The most the load window reaches past the screen, ahead of a fast scroll
+- (CGFloat)deltaLoad {
+    return MAX(_maxDeltaLoad, _minDeltaLoad);
+}
+
+- (void)setDeltaLoad:(CGFloat)value {
+    _minDeltaLoad = value;
+    _maxDeltaLoad = value;
+}
+
+- (CGRect)calculateLoadRect:(NSInteger)pos delta:(CGFloat)delta {
+    if (self.vertical) {
+        return CGRectMake(0, pos - delta, self.frame.size.width, self.frame.size.height + 2*delta);
+    }else {
+        return CGRectMake(pos - delta, 0, self.frame.size.width + 2*delta, self.frame.size.height);
+    }
+}
+
+// Rect where views are loaded. Without paging the margin ahead of the scroll grows with the speed
+// and the one behind stays at minDeltaLoad, so a still grid keeps only minDeltaLoad on both sides
+- (CGRect)calculateLoadRectForPos:(CGFloat)pos {
+    if (self.pagingEnabled) {
+        return [self calculateLoadRect:pos delta:[self calculateDelta]];
+    }
+    CGFloat ahead = MIN(MAX(fabs(_scrollVelocity) * kSMdefaultLoadAheadTime, _minDeltaLoad), MAX(_maxDeltaLoad, _minDeltaLoad));
+    CGFloat before = _scrollVelocity < 0 ? ahead : _minDeltaLoad;
+    CGFloat after = _scrollVelocity < 0 ? _minDeltaLoad : ahead;
+    if (self.vertical) {
+        return CGRectMake(0, pos - before, self.frame.size.width, self.frame.size.height + before + after);
+    }else {
+        return CGRectMake(pos - before, 0, self.frame.size.width + before + after, self.frame.size.height);
+    }
+}
+
+- (void)updateScrollVelocity {
+    CFTimeInterval now = CACurrentMediaTime();
+    CFTimeInterval interval = now - _lastOffsetTime;
+    CGFloat distance = self.vertical ? self.contentOffset.y - _lastOffset.y : self.contentOffset.x - _lastOffset.x;
+    if (interval > 0 && interval < kSMdefaultVelocityMaxInterval) {
+        // Smoothed, scroll events don't come at a regular pace
+        _scrollVelocity = (_scrollVelocity + distance / interval) / 2;
+    } else {
+        _scrollVelocity = 0;
+    }
+    _lastOffsetTime = now;
+}
+
+// Shrinks the load window back once the grid stops
+- (void)scrollDidStop {
+    _scrollVelocity = 0;
+    if (!_reloadingData && !_loadingViews) {
+        [self loadViewsForCurrentPos];
+    }
+}
+
+- (BOOL)isDraggingItem:(SMGridViewItemRef)item {
+    return !item.header && item.section == _draggingSection && item.row == _draggingItemsIndex;
+}
+
+- (void)updateCurrentSection {
+    // Last section whose header starts before the offset
+    NSInteger section = [self firstSectionStartingAtOrAfter:self.vertical ? self.contentOffset.y : self.contentOffset.x] - 1;
+    _currentSection = MAX(section, 0);
+}
+
+- (void)loadHeaderInSection:(NSInteger)section inRect:(CGRect)loadRect addedIndexes:(NSMutableArray *)addedIndexes {
+    if (![self itemsInSection:section]) {
+        return;
+    }
+    SMGridViewItemRef header = SMGridViewHeaderRefMake(section);
+    if (CGRectIntersectsRect(loadRect, [self rectForItem:header]) || [self isCurrentHeaderItemSticky:header]) {
+        [self loadItem:header inRect:loadRect addedIndexes:addedIndexes];
+    }
+    [self updateRectForItem:header];
+}
+
+// Headers are never deferred
+- (void)loadItem:(SMGridViewItemRef)item inRect:(CGRect)loadRect addedIndexes:(NSMutableArray *)addedIndexes {
+    UIView *view = [self viewForItem:item];
+    if (view && ![self isPlaceholderItem:item]) {
+        return;
+    }
+    [self materializeItem:item addedIndexes:addedIndexes];
+}
+
+- (void)materializeItem:(SMGridViewItemRef)item addedIndexes:(NSMutableArray *)addedIndexes {
+    if ([self isPlaceholderItem:item]) {
+        [self queView:item];
+    }
+    [CATransaction begin];
+    [CATransaction setDisableActions:YES];
+    [self addViewForItem:item];
+    [CATransaction commit];
+    _lastLoadCreatedViews++;
+
+    if (addedIndexes && !item.header) {
+        [addedIndexes addObject:[self indexPathForItem:item]];
+    }
+}
+
+#pragma mark - Load budget
+
+- (BOOL)loadBudgetSpent {
+    return (CFAbsoluteTimeGetCurrent() - _loadPassStart) * 1000000 >= _loadBudget;
+}
+
+// Adds the items intersecting [start, end) on the main axis and loadRect that have no view, or only a placeholder,
+// with their distance to the visible rect. The views already there get their rect updated if updateRects
+- (void)collectItemsFrom:(CGFloat)start to:(CGFloat)end inRect:(CGRect)loadRect updateRects:(BOOL)updateRects into:(SMGridViewDeferredItems *)items {
+    if (start >= end) {
+        return;
+    }
+    CGRect visibleRect = self.bounds;
+    CGFloat visibleStart = self.vertical ? CGRectGetMinY(visibleRect) : CGRectGetMinX(visibleRect);
+    CGFloat visibleEnd = self.vertical ? CGRectGetMaxY(visibleRect) : CGRectGetMaxX(visibleRect);
+    for (int section = 0; section < _sections.count; section++) {
+        SMGridViewSection *sectionItems = [_sections objectAtIndex:section];
+        [sectionItems enumerateItemsFrom:start to:end vertical:self.vertical usingBlock:^(NSUInteger index, BOOL *stop) {
+            SMGridViewItemRef item = SMGridViewItemRefMake(section, index);
+            if ([self isDraggingItem:item]) {
+                return;
+            }
+            CGRect rect = [self rectForItem:item];
+            if (!CGRectIntersectsRect(loadRect, rect) || ([sectionItems viewAtIndex:index] && ![self isPlaceholderItem:item])) {
+                if (updateRects) {
+                    [self updateRectForItem:item];
+                }
+                return;
+            }
+            if (items->count == items->capacity) {
+                items->capacity = MAX(items->capacity * 2, 16);
+                items->items = realloc(items->items, items->capacity * sizeof(SMGridViewDeferredItem));
+            }
+            CGFloat min = self.vertical ? CGRectGetMinY(rect) : CGRectGetMinX(rect);
+            CGFloat max = self.vertical ? CGRectGetMaxY(rect) : CGRectGetMaxX(rect);
+            items->items[items->count].item = item;
+            items->items[items->count].distance = MAX(0, MAX(visibleStart - max, min - visibleEnd));
+            items->count++;
+        }];
+    }
+}
+
+// Creates the views of the collected items, the visible ones first and then the closest to them until loadBudget
+// is spent. The rest get a placeholder and wait for a later run loop pass
+- (void)materializeItems:(SMGridViewDeferredItems *)items addedIndexes:(NSMutableArray *)addedIndexes {
+    qsort(items->items, items->count, sizeof(SMGridViewDeferredItem), SMGridViewDeferredItemCompare);
+    // Animated passes need every view now
+    BOOL limited = _loadBudget > 0 && !addedIndexes && !_addingOrRemoving;
+    NSUInteger i = 0;
+    for (; i < items->count; i++) {
+        // At least one per pass so deferred loads always finish
+        if (limited && i > 0 && items->items[i].distance > 0 && [self loadBudgetSpent]) {
+            break;
+        }
+        [self materializeItem:items->items[i].item addedIndexes:addedIndexes];
+        [self updateRectForItem:items->items[i].item];
+    }
+    if (i == items->count) {
+        return;
+    }
+    for (; i < items->count; i++) {
+        if (![self viewForItem:items->items[i].item]) {
+            [self addPlaceholderForItem:items->items[i].item];
+        }
+    }
+    [self scheduleDeferredLoad];
+}
+
+- (void)addPlaceholderForItem:(SMGridViewItemRef)item {
+    if (![_dataSource respondsToSelector:@selector(smGridView:placeholderViewForIndexPath:)]) {
+        return;
+    }
+    UIView *view = [_dataSource smGridView:self placeholderViewForIndexPath:[self indexPathForItem:item]];
+    if (!view) {
+        return;
+    }
+    view.frame = [self rectForItem:item];
+    [self addSubview:view];
+    [self adjustNewViewPosition:view];
+    [self setView:view forItem:item];
+    [self setPlaceholder:YES forItem:item];
+}
+
+- (void)scheduleDeferredLoad {
+    if (_deferredLoadScheduled) {
+        return;
     }
+    _deferredLoadScheduled = YES;
+    // Common modes, deferred items have to appear while the user keeps scrolling
+    [self performSelector:@selector(loadDeferredItems) withObject:nil afterDelay:0 inModes:[NSArray arrayWithObject:NSRunLoopCommonModes]];
 }
 
-- (BOOL)isDraggingIndexPath:(NSIndexPath *)indexPath {
-    return [indexPath isEqual:[NSIndexPath indexPathForRow:_draggingItemsIndex inSection:_draggingSection]];
+// Materializes the items of the last load rect still missing, in the same order as a load pass, within loadBudget
+- (void)loadDeferredItems {
+    _deferredLoadScheduled = NO;
+    CGRect loadRect = _lastLoadRect;
+    CGFloat start = self.vertical ? CGRectGetMinY(loadRect) : CGRectGetMinX(loadRect);
+    CGFloat end = self.vertical ? CGRectGetMaxY(loadRect) : CGRectGetMaxX(loadRect);
+    SMGridViewDeferredItems items = {NULL, 0, 0};
+    [self collectItemsFrom:start to:end inRect:loadRect updateRects:NO into:&items];
+    _loadPassStart = CFAbsoluteTimeGetCurrent();
+    [self materializeItems:&items addedIndexes:nil];
+    free(items.items);
 }
 
-- (void)updateCurrentSection {
-    int headerSection = 0;
-    for (int section = [self numberOfSections]-1; section >= 0; section--) {
-        SMGridViewItem *item = [self headerItemInSection:section];
-        if (self.vertical) {
-            if (self.contentOffset.y > CGRectGetMinY(item.rect)) {
-                headerSection = section;
-                break;
-            }
-        } else {
-            if (self.contentOffset.x > CGRectGetMinX(item.rect)) {
-                headerSection = section;
-                break;
-            }
+// Queue the item views that are no longer inside the load rect. Headers are never queued here
+- (void)queueItemsOutsideRect:(CGRect)loadRect {
+    [self loopVisibleItems:^(SMGridViewItemRef item, UIView *view, BOOL *stop) {
+        if (!item.header && !CGRectIntersectsRect(loadRect, [self rectForItem:item])) {
+            [self queView:item];
+            _lastLoadRecycledViews++;
         }
-    }
-    _currentSection = headerSection;
+    }];
 }
 
-- (SMGridViewItem *)firstItemInSection:(NSInteger)section {
-    NSArray *sectionItems = [self itemsInSection:section];
-    if (sectionItems.count > 0) {
-        return [sectionItems objectAtIndex:0];
-    }
-    return nil;
+- (void)invalidateLoadWindow {
+    _loadWindowValid = NO;
 }
 
-- (void)sameSizeLoadViewsForPos:(float)pos addedIndexes:(NSMutableArray *)addedIndexes {
-    pos = MAX(pos, 0);
-    [self updateCurrentSection];
-    CGRect loadRect = [self calculateLoadRect:pos delta:[self calculateDelta]];
-    int section = 0;
-    for (section = 0; section < [self numberOfSections]; section++) {
-        float sectionMax = [self findMaxValueInSection:section];
-        if (pos <= sectionMax) {
-            break;
-        }
+// Queue items intersecting [start, end) on the main axis that are no longer inside loadRect
+- (void)queueItemsFrom:(CGFloat)start to:(CGFloat)end outsideRect:(CGRect)loadRect {
+    if (start >= end) {
+        return;
     }
-    // Get first item
-    SMGridViewItem *firstItem = [self firstItemInSection:section];
-    float posInSection = MAX(0, pos - [self findMinValueInSection:section]);
-    float varDim = self.vertical?firstItem.rect.size.height:firstItem.rect.size.width;
-    int row = posInSection/(varDim+self.padding);
-    int firstItemRow = row * [self numberOfRowsInSection:section];
-    
-    NSMutableDictionary *addedItems = [NSMutableDictionary dictionary];
-    __block int count = 0;
-    [self loopItemsStarting:[NSIndexPath indexPathForRow:firstItemRow inSection:section] block:^(SMGridViewItem *item, BOOL *stop) {
-#ifdef kSMGridViewDebug
-        NSDate *date = [NSDate date];
-#endif
-        if (CGRectIntersectsRect(loadRect, item.rect) || [self isCurrentHeaderItemSticky:item]) {
-            if (!item.visible) {
-                [CATransaction begin];
-                [CATransaction setDisableActions:YES];
-                [self addViewForItem:item];
-                [CATransaction commit];
-                
-                if (addedIndexes && !item.header) {
-                    [addedIndexes addObject:item.indexPath];
-                }
-            } 
-            [addedItems setObject:[NSNumber numberWithBool:YES] forKey:item];
-        } else {
-            if (!item.header) {
-                *stop = YES;
-            }
-        }
-        count++;
-        [self updateRectForItem:item];
-#ifdef kSMGridViewDebug
-        NSLog(@"loopItem:%f",[date timeIntervalSinceNow]);
-#endif
-    }];
-    // Remove the no londer present
-    NSMutableArray *toRemove = [NSMutableArray array];
-    for (SMGridViewItem *item in _visibleItems) {
-        if (![addedItems objectForKey:item]) {
-            if (item.visible && !item.header) {
+    for (int section = 0; section < _sections.count; section++) {
+        SMGridViewSection *sectionItems = [_sections objectAtIndex:section];
+        [sectionItems enumerateItemsFrom:start to:end vertical:self.vertical usingBlock:^(NSUInteger index, BOOL *stop) {
+            SMGridViewItemRef item = SMGridViewItemRefMake(section, index);
+            if ([sectionItems viewAtIndex:index] && !CGRectIntersectsRect(loadRect, [self rectForItem:item])) {
                 [self queView:item];
+                _lastLoadRecycledViews++;
             }
-            [toRemove addObject:item];
-        }
+        }];
     }
-    [_visibleItems removeObjectsInArray:toRemove];
-            
-    [self handleLoaderDisplay:[self calculateLoadRect:pos delta:self.deltaLoaderView]];
 }
 
-- (int)startBucketForRect:(CGRect)loadRect {
-    int bucket;
-    if (self.vertical) {
-        bucket = loadRect.origin.y/kSMdefaultBucketSize;
+- (void)loadViewsForPos:(CGFloat)pos addedIndexes:(NSMutableArray *)addedIndexes {
+    CFTimeInterval passStart = CACurrentMediaTime();
+    _loadingViews = YES;
+    _loadPassStart = CFAbsoluteTimeGetCurrent();
+    _lastLoadCreatedViews = 0;
+    _lastLoadRecycledViews = 0;
+
+    if ([self estimatesSizes]) {
+        CGFloat measuredPos = [self measureEstimatedItemsForPos:pos];
+        if (measuredPos != pos) {
+            // Keep the same items in the screen, without loading from the nested scrollViewDidScroll:
+            pos = measuredPos;
+            BOOL reloadingData = _reloadingData;
+            _reloadingData = YES;
+            self.contentOffset = self.vertical ? CGPointMake(self.contentOffset.x, pos) : CGPointMake(pos, self.contentOffset.y);
+            _reloadingData = reloadingData;
+        }
+        [self measureEstimatedItemsToPos:[self measureLimitForPos:pos]];
+    }
+
+    NSInteger previousSection = _currentSection;
+    [self updateCurrentSection];
+    CGRect loadRect = [self calculateLoadRectForPos:pos];
+    _lastLoadRect = loadRect;
+
+    CGFloat start = self.vertical ? CGRectGetMinY(loadRect) : CGRectGetMinX(loadRect);
+    CGFloat end = self.vertical ? CGRectGetMaxY(loadRect) : CGRectGetMaxX(loadRect);
+    CGFloat crossSize = self.vertical ? loadRect.size.width : loadRect.size.height;
+
+    NSRange headerSections = [self rangeOfSectionsFrom:start to:end];
+    for (NSUInteger section = headerSections.location; section < NSMaxRange(headerSections); section++) {
+        [self loadHeaderInSection:section inRect:loadRect addedIndexes:addedIndexes];
+    }
+    // The sticky header can be outside the window, and the one that was sticky has to go back to its place
+    if (!NSLocationInRange(_currentSection, headerSections)) {
+        [self loadHeaderInSection:_currentSection inRect:loadRect addedIndexes:addedIndexes];
+    }
+    if (previousSection != _currentSection && !NSLocationInRange(previousSection, headerSections)) {
+        [self loadHeaderInSection:previousSection inRect:loadRect addedIndexes:addedIndexes];
+    }
+
+    // Missing items are only created once all of them are known, so the visible ones go first
+    SMGridViewDeferredItems items = {NULL, 0, 0};
+    if (_loadWindowValid && _loadWindowCrossSize == crossSize) {
+        // Only the strips that entered or left the window since last pass
+        [self collectItemsFrom:start to:MIN(end, _loadWindowStart) inRect:loadRect updateRects:NO into:&items];
+        [self collectItemsFrom:MAX(start, _loadWindowEnd) to:end inRect:loadRect updateRects:NO into:&items];
+        [self queueItemsFrom:_loadWindowStart to:MIN(_loadWindowEnd, start) outsideRect:loadRect];
+        [self queueItemsFrom:MAX(_loadWindowStart, end) to:_loadWindowEnd outsideRect:loadRect];
     } else {
-        bucket = loadRect.origin.x/kSMdefaultBucketSize;
+        [self collectItemsFrom:start to:end inRect:loadRect updateRects:YES into:&items];
+        // Remove the no londer present
+        [self queueItemsOutsideRect:loadRect];
+    }
+    [self materializeItems:&items addedIndexes:addedIndexes];
+    free(items.items);
+    _loadWindowStart = start;
+    _loadWindowEnd = end;
+    _loadWindowCrossSize = crossSize;
+    _loadWindowValid = YES;
+    [self updatePrefetchingForLoadRect:loadRect];
+
+    [self handleLoaderDisplay:[self calculateLoadRect:pos delta:self.deltaLoaderView]];
+    _loadingViews = NO;
+    _metrics.loadPasses++;
+    SMGridViewLatencyRecord(&_metrics.loadPassLatency, passStart);
+    if (_traceEvents) {
+        [self traceSpan:SMGridViewTraceSpanLoadPass section:-1 row:-1 start:passStart];
     }
-    bucket--;
-    bucket = MAX(0, bucket);
-    return bucket;
 }
 
-- (int)endBucketForRect:(CGRect)loadRect {
-    int endBucket;
-    if (self.vertical) {
-        endBucket = (loadRect.origin.y + loadRect.size.height)/kSMdefaultBucketSize;
-    } else {
-        endBucket = (loadRect.origin.x + loadRect.size.width)/kSMdefaultBucketSize;
+#pragma mark - Prefetching
+
+- (BOOL)prefetchEnabled {
+    return [_dataSource respondsToSelector:@selector(smGridView:prefetchIndexPaths:)];
+}
+
+- (void)cancelAllPrefetching {
+    if (_prefetchedIndexPaths.count > 0 && [_dataSource respondsToSelector:@selector(smGridView:cancelPrefetchingForIndexPaths:)]) {
+        [_dataSource smGridView:self cancelPrefetchingForIndexPaths:[_prefetchedIndexPaths allObjects]];
     }
-    return MIN(endBucket, _bucketItems.count-1);
+    [_prefetchedIndexPaths removeAllObjects];
 }
 
-- (void)loadViewsForPos:(float)pos addedIndexes:(NSMutableArray *)addedIndexes {
-    _loadingViews = YES;
-    
-    if ([_dataSource respondsToSelector:@selector(smGridViewSameSize:)] && [_dataSource smGridViewSameSize:self] && !self.pagingEnabled) {
-        [self sameSizeLoadViewsForPos:(NSInteger)pos addedIndexes:addedIndexes];
-        _loadingViews = NO;
+// Prefetches the items in a region ahead of loadRect in the scroll direction, as long as the distance covered in
+// kSMdefaultPrefetchTime at the current speed. Prefetched items out of that region (the user slowed down or
+// went back) are cancelled, the ones that got loaded are just forgotten
+- (void)updatePrefetchingForLoadRect:(CGRect)loadRect {
+    if (![self prefetchEnabled] || _scrollVelocity == 0) {
         return;
     }
-    
-    [self updateCurrentSection];
-    CGRect loadRect = [self calculateLoadRect:pos delta:[self calculateDelta]];
-    
-    int bucket = [self startBucketForRect:loadRect];
-    int endBucket = [self endBucketForRect:loadRect];
-    
-    NSMutableSet *bucketItems = [NSMutableSet set];
-    for (int i=bucket; i<=endBucket && i < _bucketItems.count; i++) {
-        [bucketItems addObjectsFromArray:[_bucketItems objectAtIndex:i]];
-    }
-
-    NSMutableDictionary *addedItems = [NSMutableDictionary dictionary];
-
-    for (SMGridViewItem *item in bucketItems) {
-#ifdef kSMGridViewDebug
-        NSDate *date = [NSDate date];
-#endif
-        NSIndexPath *indexPath = item.indexPath;
-        if ([self isDraggingIndexPath:indexPath] && !item.header) {
-            return;
-        }
-        BOOL visible = item.visible;
-        CGRect rect = item.rect;
-        if (CGRectIntersectsRect(loadRect, rect) || [self isCurrentHeaderItemSticky:item]) {
-            if (!visible) {
-                [CATransaction begin];
-                [CATransaction setDisableActions:YES];
-                [self addViewForItem:item];
-                [CATransaction commit];
-                
-                if (addedIndexes && !item.header) {
-                    [addedIndexes addObject:indexPath];
-                }
+    CGFloat screen = self.vertical ? self.frame.size.height : self.frame.size.width;
+    CGFloat length = MIN(fabs(_scrollVelocity) * kSMdefaultPrefetchTime, screen * kSMdefaultPrefetchMaxScreens);
+    CGFloat loadStart = self.vertical ? CGRectGetMinY(loadRect) : CGRectGetMinX(loadRect);
+    CGFloat loadEnd = self.vertical ? CGRectGetMaxY(loadRect) : CGRectGetMaxX(loadRect);
+    CGFloat start = _scrollVelocity > 0 ? loadEnd : loadStart - length;
+    CGFloat end = _scrollVelocity > 0 ? loadEnd + length : loadStart;
+
+    if (!_prefetchedIndexPaths) {
+        self.prefetchedIndexPaths = [NSMutableSet set];
+    }
+    NSMutableSet *region = [NSMutableSet set];
+    NSMutableArray *newIndexPaths = [NSMutableArray array];
+    for (int section = 0; section < _sections.count; section++) {
+        SMGridViewSection *sectionItems = [_sections objectAtIndex:section];
+        [sectionItems enumerateItemsFrom:start to:end vertical:self.vertical usingBlock:^(NSUInteger index, BOOL *stop) {
+            if ([sectionItems viewAtIndex:index]) {
+                return;
             }
-            [addedItems setObject:[NSNumber numberWithBool:YES] forKey:item];
-        }else {
-            if (visible && !item.header) {
-                [self queView:item];
+            NSIndexPath *indexPath = [NSIndexPath indexPathForRow:index inSection:section];
+            [region addObject:indexPath];
+            if (![_prefetchedIndexPaths containsObject:indexPath]) {
+                [newIndexPaths addObject:indexPath];
             }
-        }
-        [self updateRectForItem:item];
+        }];
     }
-    
-    // Remove the no londer present
-    NSMutableArray *toRemove = [NSMutableArray array];
-    for (SMGridViewItem *item in _visibleItems) {
-        if (![addedItems objectForKey:item]) {
-            if (item.visible && !item.header) {
-                [self queView:item];
-            }
-            [toRemove addObject:item];
+
+    NSMutableArray *cancelled = [NSMutableArray array];
+    for (NSIndexPath *indexPath in _prefetchedIndexPaths) {
+        if (![region containsObject:indexPath] && ![self viewForIndexPath:indexPath]) {
+            [cancelled addObject:indexPath];
         }
     }
-    [_visibleItems removeObjectsInArray:toRemove];
-
-    [self handleLoaderDisplay:[self calculateLoadRect:pos delta:self.deltaLoaderView]];
-    _loadingViews = NO;
+    self.prefetchedIndexPaths = region;
+    if (cancelled.count > 0 && [_dataSource respondsToSelector:@selector(smGridView:cancelPrefetchingForIndexPaths:)]) {
+        [_dataSource smGridView:self cancelPrefetchingForIndexPaths:cancelled];
+    }
+    if (newIndexPaths.count > 0) {
+        [_dataSource smGridView:self prefetchIndexPaths:newIndexPaths];
+    }
 }
 
 - (void)loadViewsForCurrentPosAddedIndexes:(NSMutableArray *)addedIndexes {
@@ -615,24 +1910,55 @@ typedef NSUInteger SMGridViewSortAnimSpeed;
 
 - (void)loadViewsForPos:(NSInteger)x {
     [self loadViewsForPos:x addedIndexes:nil];
-}    
+}
+
+// Finds the item of a materialized view without looking at the other items
+- (BOOL)findItem:(SMGridViewItemRef *)item forView:(UIView *)view inSection:(SMGridViewSection *)sectionItems {
+    if (!view || !sectionItems) {
+        return NO;
+    }
+    if (sectionItems.headerView == view) {
+        *item = SMGridViewHeaderRefMake(sectionItems.section);
+        return YES;
+    }
+    NSUInteger row = [sectionItems indexOfView:view];
+    if (row == NSNotFound || [sectionItems viewAtIndex:row] != view) {
+        return NO;
+    }
+    *item = SMGridViewItemRefMake(sectionItems.section, row);
+    return YES;
+}
 
 - (NSIndexPath *)indexPathForView:(UIView *)view {
-    for (NSArray *section in _items) {
-        for (SMGridViewItem *item in section) {
-            if (item.view == view) {
-                return item.indexPath;
+    SMGridViewItemRef item;
+    SMGridViewSection *sectionItems = (SMGridViewSection *)CFDictionaryGetValue(_viewSections, view);
+    if (![self findItem:&item forView:view inSection:sectionItems]) {
+        // Views moved to another section by a batch update, only one lookup per section
+        BOOL found = NO;
+        for (sectionItems in _sections) {
+            if ([self findItem:&item forView:view inSection:sectionItems]) {
+                CFDictionarySetValue(_viewSections, view, sectionItems);
+                found = YES;
+                break;
             }
         }
+        if (!found) {
+            CFDictionaryRemoveValue(_viewSections, view);
+            return nil;
+        }
     }
-    return nil;
+    if ([self isPlaceholderItem:item]) {
+        return nil;
+    }
+    return [self indexPathForItem:item];
 }
 
 - (NSInteger)itemsPerRowInSection:(NSInteger)section {
-    if ([self numberOfItemsInSection:section] == 0) {
+    if ([self itemsInSection:section].count == 0) {
         return 0;
     }
-    CGSize size = [_dataSource smGridView:self sizeForIndexPath:[NSIndexPath indexPathForRow:0 inSection:section]];
+    // Only asked once per layout of the section, paging lookups use the geometry kept in the section
+    CGSize size = [self sizeForItem:SMGridViewItemRefMake(section, 0)];
     if (self.vertical) {
         return floor((self.frame.size.height - self.padding) / (size.height + self.padding));
     }else {
@@ -641,35 +1967,70 @@ typedef NSUInteger SMGridViewSortAnimSpeed;
 }
 
 
-#pragma mark - Paging
+#pragma mark - Section bounds
 
-- (NSInteger)calculateItemsPerPageInSection:(NSInteger)section {
-    return [self numberOfRowsInSection:section] * [self itemsPerRowInSection:section];
+- (void)invalidateSectionBounds {
+    _sectionBoundsValid = NO;
 }
 
-- (NSInteger)pagingRowForIndexPath:(NSIndexPath *)indexPath {
-    int numItems = [self itemsPerRowInSection:indexPath.section];
-    if (numItems == 0) {
-        return 0;
-    } else {
-        return (indexPath.row/numItems) % [self numberOfRowsInSection:indexPath.section];
+- (void)updateSectionBounds {
+    if (_sectionBoundsValid) {
+        return;
     }
+    _sectionBoundsCount = _sections.count;
+    _sectionBounds = realloc(_sectionBounds, MAX(_sectionBoundsCount, 1) * sizeof(SMGridViewLayoutBounds));
+    for (NSUInteger section = 0; section < _sectionBoundsCount; section++) {
+        CGRect headerRect = [[_sections objectAtIndex:section] headerRect];
+        CGFloat start = self.vertical ? CGRectGetMinY(headerRect) : CGRectGetMinX(headerRect);
+        CGFloat end = [self findMaxValueInSection:section];
+        if (section > 0) {
+            // Layout already produces them in order, this only keeps the searches well defined
+            start = MAX(start, _sectionBounds[section-1].start);
+            end = MAX(end, _sectionBounds[section-1].end);
+        }
+        _sectionBounds[section].start = start;
+        _sectionBounds[section].end = end;
+    }
+    _sectionBoundsValid = YES;
+}
+
+- (NSInteger)firstSectionStartingAtOrAfter:(CGFloat)pos {
+    [self updateSectionBounds];
+    return SMGridViewLayoutBoundsSearch(_sectionBounds, _sectionBoundsCount, pos, NO, YES);
 }
 
-- (int)calculateNumberOfPagesInSection:(NSInteger)section {
-    NSArray *items = [self itemsInSection:section];
-    // -1 because of header
-    int itemsCount = items.count -1;
-    int num = (items.count > 0)?ceil(itemsCount*1.0/[self calculateItemsPerPageInSection:section]):0;
-    return num;
+- (NSInteger)firstSectionEndingAtOrAfter:(CGFloat)pos {
+    [self updateSectionBounds];
+    return SMGridViewLayoutBoundsSearch(_sectionBounds, _sectionBoundsCount, pos, YES, YES);
+}
+
+// Sections with some part in [start, end] on the main axis
+- (NSRange)rangeOfSectionsFrom:(CGFloat)start to:(CGFloat)end {
+    NSUInteger first = [self firstSectionEndingAtOrAfter:start];
+    NSUInteger last = SMGridViewLayoutBoundsSearch(_sectionBounds, _sectionBoundsCount, end, NO, NO);
+    return NSMakeRange(first, last > first ? last - first : 0);
+}
+
+
+#pragma mark - Paging
+
+// Pages of a section follow the ones of the previous section, so sections must be laid out in order
+- (void)updatePagingGeometryForSection:(NSInteger)section {
+    SMGridViewSection *sectionItems = [self itemsInSection:section];
+    NSInteger itemsPerRow = [self itemsPerRowInSection:section];
+    NSInteger itemsPerPage = [self numberOfRowsInSection:section] * itemsPerRow;
+    SMGridViewSection *prevItems = section > 0 ? [self itemsInSection:section - 1] : nil;
+    [sectionItems setItemsPerRow:itemsPerRow itemsPerPage:itemsPerPage firstPage:prevItems ? prevItems.firstPage + prevItems.pageCount : 0];
+}
+
+- (NSInteger)pagingRowForItem:(SMGridViewItemRef)item {
+    return SMGridViewLayoutSectionPagingRowForItem([self itemsInSection:item.section].layout, item.row);
 }
 
 - (void)calculateNumberOfPages {
     if (self.pagingEnabled) {
-        int total = 0;
-        for (int section = 0; section < [self numberOfSections]; section++) {
-            total += [self calculateNumberOfPagesInSection:section];
-        }
+        SMGridViewSection *lastItems = [_sections lastObject];
+        int total = lastItems ? lastItems.firstPage + lastItems.pageCount : 0;
         if ([self loaderEnabled]) {
             total++;
         }
@@ -683,24 +2044,41 @@ typedef NSUInteger SMGridViewSortAnimSpeed;
     return _numberOfPages;
 }
 
-- (BOOL)isFirstOfPage:(NSIndexPath *)indexPath {
-    int numItems = [self itemsPerRowInSection:indexPath.section];
-    if (numItems == 0) {
-        return YES;
-    }
-    if (self.pagingInverseOrder) {
-        return (indexPath.row % numItems) == 0;
-    }else {
-        return (indexPath.row % numItems) < [self numberOfRowsInSection:indexPath.section];
-    }
+- (BOOL)isFirstOfPage:(SMGridViewItemRef)item {
+    return SMGridViewLayoutSectionIsFirstOfPage([self itemsInSection:item.section].layout, item.row, self.pagingInverseOrder);
+}
+
+- (NSInteger)pageForItem:(SMGridViewItemRef)item {
+    return SMGridViewLayoutSectionPageForItem([self itemsInSection:item.section].layout, item.row);
 }
 
 - (NSInteger)pageForIndexPath:(NSIndexPath *)indexPath {
-    int numItems = [self itemsPerRowInSection:indexPath.section];
-    if (numItems == 0) {
-        return 0;
+    return [self pageForItem:[self itemForIndexPath:indexPath]];
+}
+
+- (NSRange)rangeOfItemsInPage:(NSInteger)page section:(NSInteger *)section {
+    // Last section starting at or before page. Empty sections share firstPage with the next one, so they are skipped
+    NSInteger low = 0;
+    NSInteger high = (NSInteger)_sections.count - 1;
+    NSInteger found = -1;
+    while (low <= high) {
+        NSInteger mid = (low + high) / 2;
+        if ([[_sections objectAtIndex:mid] firstPage] <= page) {
+            found = mid;
+            low = mid + 1;
+        } else {
+            high = mid - 1;
+        }
+    }
+    if (section) {
+        *section = found;
     }
-    return floor(indexPath.row/numItems);
+    SMGridViewSection *sectionItems = found >= 0 ? [_sections objectAtIndex:found] : nil;
+    if (!self.pagingEnabled || !sectionItems || page < 0 || page >= sectionItems.firstPage + sectionItems.pageCount) {
+        return NSMakeRange(NSNotFound, 0);
+    }
+    NSUInteger first = (page - sectionItems.firstPage) * sectionItems.itemsPerPage;
+    return NSMakeRange(first, MIN(sectionItems.itemsPerPage, sectionItems.count - first));
 }
 
 - (CGPoint)contentOffsetForPage:(NSInteger)page {
@@ -714,23 +2092,8 @@ typedef NSUInteger SMGridViewSortAnimSpeed;
 }
 
 - (NSInteger)findClosestPage:(CGPoint)offset targetContentOffset:(CGPoint)targetContentOffset {
-    int numPages = [self numberOfPages];
-    float diff = 9999999;
-    int page = 0;
-    for (int i=0; i < numPages; i++) {
-        CGPoint pageOffset = [self contentOffsetForPage:i];
-        float tmpDiff = 0;
-        if (self.vertical) {
-            tmpDiff = ABS(pageOffset.y - offset.y);
-        }else {
-            tmpDiff = ABS(pageOffset.x - offset.x);
-        }
-        if (tmpDiff < diff) {
-            diff = tmpDiff;
-            page = i;
-        }
-    }
-    return page;
+    CGFloat pageSize = self.vertical ? self.frame.size.height : self.frame.size.width;
+    return SMGridViewLayoutClosestPage(self.vertical ? offset.y : offset.x, pageSize, [self numberOfPages]);
 }
 
 - (NSInteger)findClosestPage:(CGPoint)offset {
@@ -831,36 +2194,47 @@ typedef NSUInteger SMGridViewSortAnimSpeed;
 }
 
 - (CGFloat)findMinValueInSectionHeaderAware:(NSInteger)section {
-    SMGridViewItem *item = [self headerItemInSection:section];
-    return self.vertical ? item.rect.origin.y : item.rect.origin.x;
+    CGRect rect = [self headerRectInSection:section];
+    if (CGRectIsNull(rect)) {
+        return 0;
+    }
+    return self.vertical ? rect.origin.y : rect.origin.x;
 }
 
 - (CGFloat)findMinValueInSection:(NSInteger)section {
-    NSArray *items = [self itemsInSection:section];
-    SMGridViewItem *item = [items objectAtIndex:0];
-    return (self.vertical ? CGRectGetMinY(item.rect) : CGRectGetMinX(item.rect)) - self.padding;
+    SMGridViewSection *sectionItems = [self itemsInSection:section];
+    CGRect rect = CGRectZero;
+    if (sectionItems.count > 0) {
+        rect = [sectionItems rectAtIndex:0];
+    } else if (sectionItems) {
+        rect = sectionItems.headerRect;
+    }
+    return (self.vertical ? CGRectGetMinY(rect) : CGRectGetMinX(rect)) - self.padding;
 }
 
 - (CGFloat)findMaxValueInSection:(NSInteger)section {
     if (self.pagingEnabled) {
         return self.numberOfPages * (self.vertical ? self.frame.size.height : self.frame.size.width);
     }
-    int maxValue = 0;
-    
-    NSArray *posArray = [self posArrayInSection:section];
-    for (NSNumber *num in posArray) {
-        // This is to prevent having empty items and padding
-        float numf = num.floatValue;
-        if (numf == self.padding) {
-            numf = 0;
-        }
-        maxValue = MAX(maxValue, numf);
+    return [self findLaidOutMaxValueInSection:section] + [self estimatedExtentInSection:section];
+}
+
+// Max value of the items already laid out, without the estimated ones
+- (CGFloat)findLaidOutMaxValueInSection:(NSInteger)section {
+    SMGridViewSection *sectionItems = [self itemsInSection:section];
+    if (sectionItems.numberOfRows == 0) {
+        return 0;
+    }
+    CGFloat maxValue = sectionItems.maxPosition;
+    // This is to prevent having empty items and padding
+    if (maxValue == self.padding) {
+        return 0;
     }
-    return maxValue;
+    return MAX(0, maxValue);
 }
 
 - (CGFloat)findMaxValue {
-    NSInteger section = [self numberOfSections] -1;
+    NSInteger section = (NSInteger)_sections.count - 1;
     if (section >= 0) {
         return [self findMaxValueInSection:section];
     }
@@ -896,8 +2270,10 @@ typedef NSUInteger SMGridViewSortAnimSpeed;
     CGSize size = self.frame.size;
     [super setFrame:frame];
     if (!CGSizeEqualToSize(size, self.frame.size)) {
+        // Paging section ends depend on the frame
+        [self invalidateSectionBounds];
         if (self.frame.size.height > size.height && !_loadingViews) {
-            [self loadViewsForCurrentPos]; 
+            [self loadViewsForCurrentPos];
         }
         [self updateLoaderFrame];
         [self updateContentSize];
@@ -908,159 +2284,157 @@ typedef NSUInteger SMGridViewSortAnimSpeed;
     return self.padding;
 }
 
-- (int)findRowToInsertIndexPath:(NSIndexPath *)indexPath {
-    NSMutableArray *posArray = [self posArrayInSection:indexPath.section];
+- (int)findRowToInsertItem:(SMGridViewItemRef)item {
     if (self.pagingEnabled && self.pagingInverseOrder) {
-        int tmp = [self pagingRowForIndexPath:indexPath];
+        int tmp = [self pagingRowForItem:item];
         return tmp;
     }else {
-        CGFloat minValue = 999999;
-        int ret = 0;
-        int numRows = [self numberOfRowsInSection:indexPath.section];
-        for (int i=0; i<numRows; i++) {
-            NSNumber *number = nil;
-            if (i >= posArray.count) {
-                number = [NSNumber numberWithFloat:[self initialPos]];
-                [posArray insertObject:number atIndex:i];
-            }else {
-                number = [posArray objectAtIndex:i];
-            }
-            CGFloat value = [number floatValue];
-            if (value < minValue) {
-                minValue = value;
-                ret = i;
-            }
-        }
-        return ret;
+        SMGridViewSection *sectionItems = [self itemsInSection:item.section];
+        [sectionItems extendPositionsToRows:[self numberOfRowsInSection:item.section] value:[self initialPos]];
+        return SMGridViewLayoutSectionRowForItem(sectionItems.layout, item.row, [self layoutParams]);
     }
 }
 
-- (void)addItem:(SMGridViewItem *)item toBucket:(int)bucket {
-    if (_bucketItems.count - 1 < bucket || _bucketItems.count == 0) {
-        NSMutableArray *items = [NSMutableArray array];
-        [items addObject:item];
-        [_bucketItems addObject:items];
+- (CGSize)sizeForItem:(SMGridViewItemRef)item {
+    SMGridViewSection *sectionItems = [self itemsInSection:item.section];
+    if (sectionItems.uniform) {
+        return sectionItems.uniformSize;
     }
-    else {
-        if (![[_bucketItems objectAtIndex:bucket] containsObject:item]) {
-            [[_bucketItems objectAtIndex:bucket] addObject:item];
-        }
+    SMGridViewItemFlags flags = [sectionItems flagsAtIndex:item.row];
+    if (flags & SMGridViewItemFlagSized) {
+        return [sectionItems rectAtIndex:item.row].size;
     }
+    CGSize size = [self dataSourceSizeForIndexPath:[self indexPathForItem:item]];
+    CGRect rect = [sectionItems rectAtIndex:item.row];
+    rect.size = size;
+    [sectionItems setRect:rect atIndex:item.row];
+    [sectionItems setFlags:flags | SMGridViewItemFlagSized atIndex:item.row];
+    return size;
 }
 
-- (CGRect)nextBucketForBucket:(int)startingBucket {
-    CGRect nextBucket;
-    if (self.vertical) {
-        nextBucket = CGRectMake(0, (startingBucket+1)*kSMdefaultBucketSize, self.frame.size.width, kSMdefaultBucketSize);
-    }
-    else {
-        nextBucket = CGRectMake((startingBucket+1)*kSMdefaultBucketSize, 0, kSMdefaultBucketSize, self.frame.size.width);
+- (CGSize)dataSourceSizeForIndexPath:(NSIndexPath *)indexPath {
+    CFTimeInterval start = CACurrentMediaTime();
+    CGSize size = [_dataSource smGridView:self sizeForIndexPath:indexPath];
+    _metrics.sizeRequests++;
+    SMGridViewLatencyRecord(&_metrics.sizeRequestLatency, start);
+    if (_traceEvents) {
+        [self traceSpan:SMGridViewTraceSpanSizeRequest section:indexPath.section row:indexPath.row start:start];
     }
-    return nextBucket;
+    return size;
 }
 
-- (void)calculateBucketForItem:(SMGridViewItem *)item {
-    float startPoint = self.vertical ? CGRectGetMinY(item.rect) :CGRectGetMinX(item.rect);
-    int startingBucket =  startPoint / kSMdefaultBucketSize;
-    
-    CGRect nextBucket = [self nextBucketForBucket:startingBucket];
-    int i = startingBucket;
-    while (CGRectIntersectsRect(nextBucket, item.rect)) {
-        i++;
-        nextBucket = [self nextBucketForBucket:i];
+// Asks the sizes of range in one call when the dataSource can, one by one otherwise
+- (void)dataSourceSizes:(CGSize *)sizes inSection:(NSInteger)section range:(NSRange)range {
+    if (![_dataSource respondsToSelector:@selector(smGridView:sizes:forItemsInSection:range:)]) {
+        for (NSUInteger i = 0; i < range.length; i++) {
+            sizes[i] = [self dataSourceSizeForIndexPath:[NSIndexPath indexPathForRow:range.location + i inSection:section]];
+        }
+        return;
     }
-    int endingBucket = i;
-    
-    for (int i = startingBucket; i <= endingBucket; i++) {
-        [self addItem:item toBucket:i];
+    CFTimeInterval start = CACurrentMediaTime();
+    [_dataSource smGridView:self sizes:sizes forItemsInSection:section range:range];
+    _metrics.sizeRequests += range.length;
+    SMGridViewLatencyRecord(&_metrics.sizeRequestLatency, start);
+    if (_traceEvents) {
+        // Row is the first of the range
+        [self traceSpan:SMGridViewTraceSpanSizesRequest section:section row:range.location start:start];
     }
 }
 
-- (CGRect)calculateRectForIndexPath:(NSIndexPath *)indexPath row:(NSInteger)row addIndexPath:(NSIndexPath *)addIndexPath {
-    NSMutableArray *posArray = [self posArrayInSection:indexPath.section];
-    NSNumber *rowValue = [posArray objectAtIndex:row];
-    
-    SMGridViewItem *item = [self itemAtIndexPath:indexPath];
-    CGRect rect = CGRectZero;
-    if (item && !addIndexPath && !item.header) {
-        rect = item.rect;
-    } else {
-        CGSize size = [_dataSource smGridView:self sizeForIndexPath:indexPath];
-        rect = CGRectMake(0, 0, size.width, size.height);
-    }
-    
-    
-    CGPoint pagingOffset = CGPointZero;
-    if (self.pagingEnabled && [self isFirstOfPage:indexPath]) {
-        pagingOffset = [self contentOffsetForPage:[self pageForIndexPath:indexPath]];
+// Fills the size cache for the items in range not sized yet, with one dataSource call per run of missing sizes
+- (void)loadSizesInSection:(NSInteger)section range:(NSRange)range {
+    if (![_dataSource respondsToSelector:@selector(smGridView:sizes:forItemsInSection:range:)]) {
+        return;
     }
-    
-    if (self.vertical) {
-        float yValue = CGPointEqualToPoint(CGPointZero, pagingOffset) ? rowValue.floatValue : pagingOffset.y + self.padding;
-        rect.origin = CGPointMake(row*(rect.size.width + self.padding) + self.padding, yValue);    
-    }else {
-        float xValue = CGPointEqualToPoint(CGPointZero, pagingOffset) ? rowValue.floatValue : pagingOffset.x + self.padding;
-        rect.origin = CGPointMake(xValue, row*(rect.size.height + self.padding) + self.padding);
+    SMGridViewSection *sectionItems = [self itemsInSection:section];
+    NSUInteger end = MIN(NSMaxRange(range), sectionItems.count);
+    NSUInteger i = range.location;
+    while (i < end) {
+        if ([sectionItems flagsAtIndex:i] & SMGridViewItemFlagSized) {
+            i++;
+            continue;
+        }
+        NSUInteger runEnd = i + 1;
+        while (runEnd < end && !([sectionItems flagsAtIndex:runEnd] & SMGridViewItemFlagSized)) {
+            runEnd++;
+        }
+        NSUInteger length = runEnd - i;
+        CGSize *sizes = malloc(length * sizeof(CGSize));
+        [self dataSourceSizes:sizes inSection:section range:NSMakeRange(i, length)];
+        for (NSUInteger j = 0; j < length; j++) {
+            CGRect rect = [sectionItems rectAtIndex:i + j];
+            rect.size = sizes[j];
+            [sectionItems setRect:rect atIndex:i + j];
+            [sectionItems setFlags:[sectionItems flagsAtIndex:i + j] | SMGridViewItemFlagSized atIndex:i + j];
+        }
+        free(sizes);
+        i = runEnd;
     }
-    return rect;
 }
 
-- (void)updatePosArray:(NSMutableArray *)posArray row:(NSInteger)row item:(SMGridViewItem *)item {
-    CGRect rect = item.rect;
-    CGFloat value;
-    if (self.vertical) {
-        value = CGRectGetMaxY(rect) + self.padding;
-    }else {
-        value = CGRectGetMaxX(rect) + self.padding;
+// Sections are only laid out close to the visible area when the dataSource gives an estimated size.
+// Paging and same size grids don't need it, their extent is known without asking every size
+- (BOOL)estimatesSizes {
+    if (self.pagingEnabled || ![_dataSource respondsToSelector:@selector(smGridView:estimatedSizeForItemsInSection:)]) {
+        return NO;
     }
-    [posArray replaceObjectAtIndex:row withObject:[NSNumber numberWithFloat:value]];
-    [self calculateBucketForItem:item];
+    return ![self sameSize];
 }
 
-- (void)loopItems:(void (^)(SMGridViewItem *item))block {
-    for (NSArray *section in _items) {
-        for (SMGridViewItem *item in section) {
-            block(item);
-        }
-    }
+- (BOOL)sameSize {
+    return [_dataSource respondsToSelector:@selector(smGridViewSameSize:)] && [_dataSource smGridViewSameSize:self];
 }
 
-- (void)loopItemsStarting:(NSIndexPath *)start block:(void (^)(SMGridViewItem *item, BOOL *stop))block {
-    BOOL stop = NO;
-    for (int section = start.section; section < [self numberOfSections]; section++) {
-        // Always do header
-        SMGridViewItem *header = [self headerItemInSection:section];
-        block(header, &stop);
-        int initialRow = (start.section == section) ? start.row : 0;
-        NSArray *items = [self itemsInSection:section];
-        for (int row = initialRow; row < items.count; row++) {
-            SMGridViewItem *item = [items objectAtIndex:row];
-            if (!item.header) {
-                block(item, &stop);
-            }
-            if (stop) {
-                return;
-            }
-        }
+// Space taken by the items not laid out yet, using the estimated size
+- (CGFloat)estimatedExtentInSection:(NSInteger)section {
+    SMGridViewSection *sectionItems = [self itemsInSection:section];
+    if (sectionItems.layoutCount >= sectionItems.count || ![self estimatesSizes]) {
+        return 0;
     }
+    CGSize size = [_dataSource smGridView:self estimatedSizeForItemsInSection:section];
+    NSUInteger rows = MAX(sectionItems.numberOfRows, 1);
+    NSUInteger lines = (sectionItems.count - sectionItems.layoutCount + rows - 1) / rows;
+    return lines * ((self.vertical ? size.height : size.width) + self.padding);
 }
 
-- (SMGridViewItem *)itemAtIndexPath:(NSIndexPath *)indexPath {
-    if (indexPath.section < _items.count) {
-        NSArray *items = [self itemsInSection:indexPath.section];
-        if (indexPath.row < items.count) {
-            return [items objectAtIndex:indexPath.row];
-        }
-    }
-    return nil;
+// Items are laid out up to one screen (or deltaLoad if bigger) after the visible area
+- (CGFloat)measureLimitForPos:(CGFloat)pos {
+    CGFloat size = self.vertical ? self.frame.size.height : self.frame.size.width;
+    return pos + size + MAX([self calculateDelta], size);
 }
 
-- (NSMutableArray *)itemsInSection:(NSInteger)section {
-    if (section < _items.count) {
-        return [_items objectAtIndex:section];
-    } else {
-        return nil;
+- (CGFloat)measureLimit {
+    return [self measureLimitForPos:self.vertical ? self.contentOffset.y : self.contentOffset.x];
+}
+
+// Where the next item not laid out would start
+- (CGFloat)layoutFrontierInSection:(NSInteger)section {
+    SMGridViewSection *sectionItems = [self itemsInSection:section];
+    CGFloat minValue = FLT_MAX;
+    for (NSUInteger i = 0; i < sectionItems.numberOfRows; i++) {
+        minValue = MIN(minValue, sectionItems.positions[i]);
     }
+    return minValue;
+}
+
+// Placement math lives in the layout core, the grid only passes it what the dataSource says
+- (SMGridViewLayoutParams)layoutParams {
+    SMGridViewLayoutParams params;
+    params.padding = self.padding;
+    params.vertical = self.vertical;
+    params.pageSize = self.pagingEnabled ? (self.vertical ? self.frame.size.height : self.frame.size.width) : 0;
+    params.inverseOrder = self.pagingInverseOrder;
+    return params;
+}
+
+- (CGRect)calculateRectForItem:(SMGridViewItemRef)item row:(NSInteger)row {
+    CGSize size = [self sizeForItem:item];
+    SMGridViewLayoutSize layoutSize = {size.width, size.height};
+    return SMGridViewCGRectFromLayoutRect(SMGridViewLayoutSectionRectForItem([self itemsInSection:item.section].layout, item.row, row, layoutSize, [self layoutParams]));
+}
+
+- (void)updatePositionsForItem:(SMGridViewItemRef)item row:(NSInteger)row {
+    SMGridViewLayoutSectionAdvanceRow([self itemsInSection:item.section].layout, row, SMGridViewLayoutRectFromCGRect([self rectForItem:item]), [self layoutParams]);
 }
 
 - (NSInteger)numberOfSections {
@@ -1082,31 +2456,11 @@ typedef NSUInteger SMGridViewSortAnimSpeed;
     return [_dataSource smGridView:self numberOfItemsInSection:section];
 }
 
-- (SMGridViewItem *)headerItemInSection:(NSInteger)section {
-    if (section >= _items.count) {
-        return nil;
-    }
-    NSArray *items = [_items objectAtIndex:section];
-    if (items.count > 0) {
-        SMGridViewItem *item = [items objectAtIndex:items.count -1];
-        if (item.header) {
-            return item;
-        }
-    }
-    return nil;
-}
-
-- (NSMutableArray *)posArrayInSection:(NSInteger)section {
-    for (int s = _posArrays.count; s <= section; s++) {
-        [_posArrays addObject:[NSMutableArray array]];
-    }
-    return [_posArrays objectAtIndex:section];
-}
-
-- (void)addHeaderInSection:(NSInteger)section items:(NSMutableArray *)items {
-    float firstPos = [[[self posArrayInSection:section] objectAtIndex:0] floatValue];
+- (void)addHeaderInSection:(NSInteger)section {
+    SMGridViewSection *sectionItems = [self itemsInSection:section];
+    CGFloat firstPos = sectionItems.numberOfRows > 0 ? sectionItems.positions[0] : 0;
     CGRect rect = self.vertical?CGRectMake(0, firstPos, 0, 0):CGRectMake(firstPos, 0, 0, 0);
-    
+
     if ([_dataSource respondsToSelector:@selector(smGridView:sizeForHeaderInSection:)]) {
         CGSize size = [_dataSource smGridView:self sizeForHeaderInSection:section];
         if (self.vertical) {
@@ -1115,82 +2469,210 @@ typedef NSUInteger SMGridViewSortAnimSpeed;
             rect = CGRectMake(firstPos, 0, size.width, self.frame.size.height);
         }
     }
-    SMGridViewItem *item = [self headerItemInSection:section];
-    if (!item) {
-        item = [[[SMGridViewItem alloc] initWithRect:rect] autorelease];
-    } else {
-        item.rect = rect;
-    }
-    item.indexPath = [NSIndexPath indexPathForRow:0 inSection:section];
-    item.header = YES;
-    [items addObject:item];
-    NSMutableArray *posArray = [self posArrayInSection:section];
-    // Update posArray
-    for (int i=0; i < posArray.count; i++) {
-        [self updatePosArray:posArray row:i item:item];
-    }
-}
-
-- (NSMutableArray *)createPosArrayForSection:(NSInteger)section {
-    NSMutableArray *posArray = [NSMutableArray array];
-    int numRows = [self numberOfRowsInSection:section];
-    float maxValue = self.padding;
-    if (section > 0) {
-        maxValue = [self findMaxValueInSection:section-1];
-    }
-    for (int i = 0; i < numRows; i++) {
-        [posArray addObject:[NSNumber numberWithFloat:maxValue]];
+    sectionItems.headerRect = rect;
+    // Update positions
+    for (int i=0; i < sectionItems.numberOfRows; i++) {
+        [self updatePositionsForItem:SMGridViewHeaderRefMake(section) row:i];
     }
-    return posArray;
 }
 
-- (void)updatePosArrayForSection:(NSInteger)section {
+- (CGFloat)layoutStartForSection:(NSInteger)section {
     // Find furthest row in prev
-    float value = 0;
+    CGFloat value = 0;
     if (section > 0) {
         value = [self findMaxValueInSection:section-1];
     }
-    NSMutableArray *posArray = [self posArrayInSection:section];
-    [posArray removeAllObjects];
-    int numRows = [self numberOfRowsInSection:section];
-    for (int i = 0; i < numRows; i++) {
-        [posArray addObject:[NSNumber numberWithFloat:value]];
-    }
+    return value;
+}
+
+- (void)updatePositionsForSection:(NSInteger)section {
+    CGFloat value = [self layoutStartForSection:section];
+    SMGridViewSection *sectionItems = [self itemsInSection:section];
+    sectionItems.layoutStart = value;
+    [sectionItems resetPositionsWithRows:[self numberOfRowsInSection:section] value:value];
 }
 
 - (int)countOfDataSourceInSection:(NSInteger)section {
     return [self numberOfItemsInSection:section];
 }
 
-- (NSMutableArray *)updatedItemsAddIndexPath:(NSIndexPath *)addIndexPath section:(NSInteger)section {
-    [self updatePosArrayForSection:section];
-    NSMutableArray *tmpSectionItems = [NSMutableArray array];
-    [self addHeaderInSection:section items:tmpSectionItems];
+- (void)removeViewsInSection:(NSInteger)section fromRow:(NSUInteger)row {
+    [self invalidateLoadWindow];
+    [[self itemsInSection:section] enumerateViewsUsingBlock:^(NSUInteger index, UIView *view, BOOL *stop) {
+        if (index >= row) {
+            [self queView:SMGridViewItemRefMake(section, index)];
+        }
+    }];
+}
+
+- (void)layoutSection:(NSInteger)section fromIndex:(NSUInteger)fromIndex addIndexPath:(NSIndexPath *)addIndexPath {
+    SMGridViewSection *sectionItems = [self itemsInSection:section];
+    [self invalidateLoadWindow];
+    BOOL adding = addIndexPath && addIndexPath.section == section;
+    if (adding) {
+        // New item keeps no size, so it is asked to the dataSource. Items after it keep their views
+        [sectionItems insertItemAtIndex:addIndexPath.row];
+    }
     int count = [self countOfDataSourceInSection:section];
-    NSMutableArray *items = [self itemsInSection:section];
-    for (int i = 0; i < count; i++) {
-        NSIndexPath *indexPath = [NSIndexPath indexPathForRow:i inSection:section];
-        int row = [self findRowToInsertIndexPath:indexPath];
-        // Number of items -1 because of header
-        int itemsCount = (addIndexPath && addIndexPath.section == section) ? items.count : items.count-1;
-        SMGridViewItem *item = nil;
-        // If we are redispaying an item, we don't want to lose its 'view' property
-        if (items && i < itemsCount && ![addIndexPath isEqual:indexPath]) {
-            NSInteger origIndex = (addIndexPath && addIndexPath.section == section && i > addIndexPath.row) ? i-1 :i;
-            item = [items objectAtIndex:origIndex];
-            item.rect = [self calculateRectForIndexPath:[NSIndexPath indexPathForRow:i inSection:section] row:row addIndexPath:addIndexPath];
-            item.toAdd = NO;
-        }else {
-            item = [[[SMGridViewItem alloc] init] autorelease];
-            item.rect = [self calculateRectForIndexPath:indexPath row:row addIndexPath:addIndexPath];
-            item.toAdd = ([indexPath isEqual:addIndexPath]);
+    if (sectionItems.count > count) {
+        [self removeViewsInSection:section fromRow:count];
+    }
+    sectionItems.count = count;
+    BOOL uniform = [self sameSize];
+    if (uniform) {
+        CGSize size = count > 0 ? [self dataSourceSizeForIndexPath:[NSIndexPath indexPathForRow:0 inSection:section]] : CGSizeZero;
+        [sectionItems useUniformItemSize:size];
+    } else if (sectionItems.uniform) {
+        [sectionItems usePerItemRects];
+        sectionItems.laidOut = NO;
+    }
+    [self updatePagingGeometryForSection:section];
+
+    if (uniform) {
+        [self updatePositionsForSection:section];
+        [self addHeaderInSection:section];
+        [self layoutUniformSection:section start:sectionItems.numberOfRows > 0 ? sectionItems.positions[0] : sectionItems.layoutStart addIndexPath:addIndexPath];
+        sectionItems.laidOut = YES;
+        return;
+    }
+
+    // Resume from the closest checkpoint when the section start and its rows didn't change
+    NSUInteger start = NSNotFound;
+    if (fromIndex > 0 && sectionItems.laidOut && sectionItems.numberOfRows == [self numberOfRowsInSection:section]) {
+        start = [sectionItems restoreCheckpointBeforeIndex:MIN(fromIndex, count)];
+    }
+    if (start == NSNotFound) {
+        [self updatePositionsForSection:section];
+        [self addHeaderInSection:section];
+        start = 0;
+    }
+    [self layoutItemsInSection:section from:start toIndex:count limit:[self measureLimit] addIndexPath:addIndexPath];
+    sectionItems.laidOut = YES;
+}
+
+// Same size items are not laid out one by one, their rects are computed from the first line start when asked
+- (void)layoutUniformSection:(NSInteger)section start:(CGFloat)start addIndexPath:(NSIndexPath *)addIndexPath {
+    SMGridViewSection *sectionItems = [self itemsInSection:section];
+    [self invalidateSectionBounds];
+    [sectionItems layoutUniformWithStart:start params:[self layoutParams]];
+    if (addIndexPath && addIndexPath.section == section) {
+        [self setToAdd:YES forItem:[self itemForIndexPath:addIndexPath]];
+    }
+}
+
+// Lays out items from start (positions must be the ones before it) until toIndex.
+// When sizes are estimated it also stops once the rows reach limit, the added item is always laid out
+- (void)layoutItemsInSection:(NSInteger)section from:(NSUInteger)start toIndex:(NSUInteger)toIndex limit:(CGFloat)limit addIndexPath:(NSIndexPath *)addIndexPath {
+    SMGridViewSection *sectionItems = [self itemsInSection:section];
+    BOOL adding = addIndexPath && addIndexPath.section == section;
+    BOOL estimating = [self estimatesSizes];
+    NSUInteger end = MIN(toIndex, sectionItems.count);
+    NSUInteger mustReach = adding ? addIndexPath.row + 1 : 0;
+    if (!estimating && end > start) {
+        [self loadSizesInSection:section range:NSMakeRange(start, end - start)];
+    }
+    [self invalidateSectionBounds];
+    NSUInteger i;
+    for (i = start; i < end; i++) {
+        SMGridViewItemRef item = SMGridViewItemRefMake(section, i);
+        [sectionItems saveCheckpointAtIndex:i];
+        int row = [self findRowToInsertItem:item];
+        if (estimating) {
+            if (sectionItems.positions[row] > limit && i >= mustReach) {
+                break;
+            }
+            if (i == start || i % SMGridViewLayoutCheckpointInterval == 0) {
+                // Sizes are asked one checkpoint interval at a time, only for what gets laid out
+                [self loadSizesInSection:section range:NSMakeRange(i, SMGridViewLayoutCheckpointInterval - i % SMGridViewLayoutCheckpointInterval)];
+            }
+        }
+        [sectionItems setRect:[self calculateRectForItem:item row:row] atIndex:i];
+        if (adding && addIndexPath.row == i) {
+            [self setToAdd:YES forItem:item];
         }
-        item.indexPath = indexPath;
-        [tmpSectionItems insertObject:item atIndex:i];
         // If we're adding, do not update x value. (Because of animation stuff).
-        [self updatePosArray:[self posArrayInSection:section] row:row item:item];
+        [self updatePositionsForItem:item row:row];
+    }
+    sectionItems.layoutCount = i;
+}
+
+// Continues the layout of estimated sections up to pos, moving the sections after them. Returns YES if anything changed
+- (BOOL)measureEstimatedItemsToPos:(CGFloat)pos {
+    BOOL changed = NO;
+    for (int section = 0; section < _sections.count; section++) {
+        SMGridViewSection *sectionItems = [_sections objectAtIndex:section];
+        if (changed) {
+            [self moveSectionToLayoutStart:section];
+        }
+        if (sectionItems.laidOut && sectionItems.layoutCount < sectionItems.count && [self layoutFrontierInSection:section] <= pos) {
+            NSUInteger layoutCount = sectionItems.layoutCount;
+            [self layoutItemsInSection:section from:layoutCount toIndex:sectionItems.count limit:pos addIndexPath:nil];
+            changed = changed || sectionItems.layoutCount != layoutCount;
+        }
+    }
+    if (changed) {
+        [self invalidateLoadWindow];
+        [self updateExtraViews:YES];
+    }
+    return changed;
+}
+
+// Lays out the estimated items of a section up to indexPath, so its rect is the real one
+- (void)measureItemsUpToIndexPath:(NSIndexPath *)indexPath {
+    SMGridViewSection *sectionItems = [self itemsInSection:indexPath.section];
+    if (!sectionItems.laidOut || indexPath.row < sectionItems.layoutCount || indexPath.row >= sectionItems.count) {
+        return;
+    }
+    [self layoutItemsInSection:indexPath.section from:sectionItems.layoutCount toIndex:indexPath.row + 1 limit:FLT_MAX addIndexPath:nil];
+    for (int section = indexPath.section + 1; section < _sections.count; section++) {
+        [self moveSectionToLayoutStart:section];
+    }
+    [self invalidateLoadWindow];
+    [self updateExtraViews:YES];
+}
+
+// If pos falls in the estimated part of a section (a jump with the scroll indicator or setContentOffset:),
+// lays out the items up to there and returns the pos that shows the same item at the same place
+- (CGFloat)measureEstimatedItemsForPos:(CGFloat)pos {
+    for (int section = 0; section < _sections.count; section++) {
+        SMGridViewSection *sectionItems = [_sections objectAtIndex:section];
+        CGFloat extent = [self estimatedExtentInSection:section];
+        if (extent == 0) {
+            continue;
+        }
+        CGFloat estimatedStart = [self findLaidOutMaxValueInSection:section];
+        if (pos < estimatedStart || pos >= estimatedStart + extent) {
+            continue;
+        }
+        CGSize size = [_dataSource smGridView:self estimatedSizeForItemsInSection:section];
+        CGFloat lineExtent = (self.vertical ? size.height : size.width) + self.padding;
+        NSUInteger line = (pos - estimatedStart) / lineExtent;
+        NSUInteger item = MIN(sectionItems.layoutCount + line * MAX(sectionItems.numberOfRows, 1), sectionItems.count - 1);
+        CGFloat posInItem = pos - (estimatedStart + line * lineExtent);
+        [self measureItemsUpToIndexPath:[NSIndexPath indexPathForRow:item inSection:section]];
+        CGRect rect = [sectionItems rectAtIndex:item];
+        return (self.vertical ? CGRectGetMinY(rect) : CGRectGetMinX(rect)) + posInItem;
+    }
+    return pos;
+}
+
+- (void)layoutSection:(NSInteger)section addIndexPath:(NSIndexPath *)addIndexPath {
+    [self layoutSection:section fromIndex:0 addIndexPath:addIndexPath];
+}
+
+// Sections after a change keep their internal layout, they only need to start where the previous one ends now
+- (void)moveSectionToLayoutStart:(NSInteger)section {
+    SMGridViewSection *sectionItems = [self itemsInSection:section];
+    if (!sectionItems.laidOut || sectionItems.numberOfRows != [self numberOfRowsInSection:section] || self.pagingEnabled) {
+        [self layoutSection:section addIndexPath:nil];
+        return;
+    }
+    CGFloat delta = [self layoutStartForSection:section] - sectionItems.layoutStart;
+    if (delta != 0) {
+        [self invalidateLoadWindow];
+        [self invalidateSectionBounds];
+        [sectionItems shiftBy:delta vertical:self.vertical];
     }
-    return tmpSectionItems;
 }
 
 - (void)updateExtraViews:(BOOL)updateContentSize {
@@ -1202,17 +2684,67 @@ typedef NSUInteger SMGridViewSortAnimSpeed;
     [self updateEmptyView];
 }
 
-- (void)updateItemsAddIndexPath:(NSIndexPath *)addIndexPath updateContentSize:(BOOL)updateContentSize {
-    NSMutableArray *tmpItems = [[NSMutableArray alloc] init];
-    [self resetPosArrays];
-    // To track which row to insert
-    for (int section = 0; section < [self numberOfSections]; section++) {
-        [tmpItems addObject:[self updatedItemsAddIndexPath:addIndexPath section:section]];
-    }
-    
-    [_items release];
-    _items = tmpItems;
+- (void)updateNumberOfSections:(NSInteger)numberOfSections {
+    [self invalidateSectionBounds];
+    while (_sections.count > numberOfSections) {
+        [self removeAllViewsInSection:_sections.count - 1];
+        [_sections removeLastObject];
+    }
+    [self addMissingSections:numberOfSections];
+}
+
+// Lays out again only from changedIndexPath. Sections before it are untouched and the ones after it are moved
+// changedRows holds the first changed row of every section, NSNotFound if unchanged. NULL lays out everything
+- (void)layoutItemsWithChangedRows:(const NSUInteger *)changedRows addIndexPath:(NSIndexPath *)addIndexPath {
+    CFTimeInterval start = CACurrentMediaTime();
+    // Prefetched indexPaths may not point to the same items anymore
+    [self cancelAllPrefetching];
+    NSInteger numberOfSections = [self numberOfSections];
+    if (_sections.count != numberOfSections) {
+        [self updateNumberOfSections:numberOfSections];
+        changedRows = NULL;
+    }
+    BOOL changed = NO;
+    for (int section = 0; section < numberOfSections; section++) {
+        if (!changedRows) {
+            [self layoutSection:section addIndexPath:addIndexPath];
+        } else if (changedRows[section] != NSNotFound) {
+            [self layoutSection:section fromIndex:changedRows[section] addIndexPath:addIndexPath];
+            changed = YES;
+        } else if (changed) {
+            [self moveSectionToLayoutStart:section];
+        }
+    }
+    _metrics.relayouts++;
+    SMGridViewLatencyRecord(&_metrics.relayoutLatency, start);
+}
+
+- (void)layoutItemsFromIndexPath:(NSIndexPath *)changedIndexPath addIndexPath:(NSIndexPath *)addIndexPath {
+    NSUInteger *changedRows = NULL;
+    if (changedIndexPath && changedIndexPath.section < _sections.count) {
+        changedRows = malloc(_sections.count * sizeof(NSUInteger));
+        for (NSUInteger section = 0; section < _sections.count; section++) {
+            changedRows[section] = NSNotFound;
+        }
+        changedRows[changedIndexPath.section] = changedIndexPath.row;
+    }
+    [self layoutItemsWithChangedRows:changedRows addIndexPath:addIndexPath];
+    free(changedRows);
+}
+
+- (void)updateItemsFromIndexPath:(NSIndexPath *)changedIndexPath addIndexPath:(NSIndexPath *)addIndexPath updateContentSize:(BOOL)updateContentSize {
+    CFTimeInterval start = CACurrentMediaTime();
+    [self layoutItemsFromIndexPath:changedIndexPath addIndexPath:addIndexPath];
     [self updateExtraViews:updateContentSize];
+    if (_traceEvents) {
+        // The added item if any, otherwise the first changed one
+        NSIndexPath *indexPath = addIndexPath ? addIndexPath : changedIndexPath;
+        [self traceSpan:SMGridViewTraceSpanUpdateItems section:indexPath ? indexPath.section : -1 row:indexPath ? indexPath.row : -1 start:start];
+    }
+}
+
+- (void)updateItemsAddIndexPath:(NSIndexPath *)addIndexPath updateContentSize:(BOOL)updateContentSize {
+    [self updateItemsFromIndexPath:nil addIndexPath:addIndexPath updateContentSize:updateContentSize];
 }
 
 - (void)updateItemsAddIndexPath:(NSIndexPath *)addIndexPath {
@@ -1224,64 +2756,57 @@ typedef NSUInteger SMGridViewSortAnimSpeed;
 }
 
 - (UIView *)viewForIndexPath:(NSIndexPath *)indexPath {
-    return [self itemAtIndexPath:indexPath].view;
+    SMGridViewItemRef item = [self itemForIndexPath:indexPath];
+    return [self isPlaceholderItem:item] ? nil : [self viewForItem:item];
 }
 
 - (void)removeAllViews {
-    [self loopItems:^(SMGridViewItem *item) {
-        if (item.view) {
-            [self queView:item];
-        }
+    [self invalidateLoadWindow];
+    [self loopVisibleItems:^(SMGridViewItemRef item, UIView *view, BOOL *stop) {
+        [self queView:item];
     }];
 }
 
 - (void)removeAllViewsInSection:(NSInteger)section {
-    NSArray *items = [self itemsInSection:section];
-    for (SMGridViewItem *item in items) {
-        if (item.view) {
-            [self queView:item];
-        }
-    }
+    [self removeViewsInSection:section fromRow:0];
+    [self queView:SMGridViewHeaderRefMake(section)];
 }
 
 - (BOOL)hasItems {
-    for (NSArray *items in _items) {
-        for (SMGridViewItem *item in items) {
-            if (!item.header) {
-                return YES;
-            }
+    for (SMGridViewSection *sectionItems in _sections) {
+        if (sectionItems.count > 0) {
+            return YES;
         }
     }
     return NO;
 }
 
-- (void)resetPosArrays {
-    NSMutableArray *tmp = [NSMutableArray array];
-    for (int section = 0; section < [self numberOfSections]; section++) {
-        [tmp addObject:[NSMutableArray array]];
-    }
-    self.posArrays = tmp;
-}
-
 - (void)resetItemsInSection:(NSInteger)section {
-    [[self itemsInSection:section] removeAllObjects];
+    SMGridViewSection *sectionItems = [self itemsInSection:section];
+    sectionItems.count = 0;
+    sectionItems.laidOut = NO;
+    [self invalidateSectionBounds];
 }
 
 - (void)reloadSection:(NSInteger)section {
-    if ((_enableSort && _items) || self.busy) {
+    if (_enableSort && _sections) {
+        return;
+    }
+    if (self.busy) {
+        [self enqueuePendingUpdate:^{
+            [self reloadSection:section];
+        }];
         return;
     }
-    if (!_items) {
+    if (!_sections) {
         [self reloadData];
         return;
     }
     _reloadingData = YES;
     [self removeAllViewsInSection:section];
     [self resetItemsInSection:section];
-    // Update all following sectsions
-    for (int i = section; i < MIN(_items.count, [self numberOfSections]); i++) {
-        [_items replaceObjectAtIndex:i withObject:[self updatedItemsAddIndexPath:nil section:i]];
-    }
+    // Following sections only need to be moved
+    [self layoutItemsFromIndexPath:[NSIndexPath indexPathForRow:0 inSection:section] addIndexPath:nil];
     _reloadingData = NO;
     [self updateExtraViews:YES];
     [self loadViewsForCurrentPos];
@@ -1289,50 +2814,233 @@ typedef NSUInteger SMGridViewSortAnimSpeed;
 
 
 - (void)reloadSectionOnlyNew:(NSInteger)section {
-    if ((_enableSort && _items) || self.busy) {
+    if (_enableSort && _sections) {
+        return;
+    }
+    if (self.busy) {
+        [self enqueuePendingUpdate:^{
+            [self reloadSectionOnlyNew:section];
+        }];
+        return;
+    }
+    if (!_sections) {
+        [self reloadData];
+        return;
+    }
+    [self checkCorrectArrays];
+    NSInteger added = [self numberOfItemsInSection:section] - (NSInteger)[self itemsInSection:section].count;
+    [self layoutAppendedItems:MAX(added, 0) inSection:section];
+}
+
+// Lays out count items added at the end of section, the ones before keep their rects. Sections after it are moved
+- (void)layoutAppendedItems:(NSUInteger)added inSection:(NSInteger)section {
+    SMGridViewSection *sectionItems = [self itemsInSection:section];
+    _reloadingData = YES;
+    [self invalidateLoadWindow];
+
+    BOOL changed = added > 0 || !sectionItems.laidOut;
+    if (!sectionItems.laidOut) {
+        // Empty or never laid out, all its items are new
+        [self layoutSection:section addIndexPath:nil];
+    } else if (added > 0) {
+        NSUInteger first = sectionItems.count;
+        NSUInteger count = first + added;
+        // If the section still has estimated items, the new ones are just more of them
+        BOOL laidOut = sectionItems.layoutCount == first;
+        sectionItems.count = count;
+        [self invalidateSectionBounds];
+        [self updatePagingGeometryForSection:section];
+        if (sectionItems.uniform) {
+            [sectionItems resetPositionsWithRows:sectionItems.numberOfRows value:sectionItems.uniformStart];
+            [self layoutUniformSection:section start:sectionItems.uniformStart addIndexPath:nil];
+        } else if (laidOut) {
+            [self layoutItemsInSection:section from:first toIndex:count limit:[self measureLimit] addIndexPath:nil];
+        }
+    }
+    if (changed) {
+        for (int i = section + 1; i < _sections.count; i++) {
+            [self moveSectionToLayoutStart:i];
+        }
+    }
+
+    [self updateExtraViews:YES];
+    _reloadingData = NO;
+    [self loadViewsForCurrentPos];
+}
+
+- (void)appendItems:(NSUInteger)count toSection:(NSInteger)section {
+    if (!_sections) {
+        [self reloadData];
+        return;
+    }
+    if (self.busy) {
+        [self enqueuePendingUpdate:^{
+            [self appendItems:count toSection:section];
+        }];
+        return;
+    }
+    [self checkCorrectArrays];
+    if ((NSUInteger)[self numberOfItemsInSection:section] != [self itemsInSection:section].count + count) {
+        // Not only an append
+        [self reloadSection:section];
         return;
     }
-    if (!_items) {
+    [self layoutAppendedItems:count inSection:section];
+}
+
+// Inserts count items at the section start and lays them out. If every row moved by the same amount the items
+// after them keep their layout and only the section offset changes, otherwise returns NO and the section has to be laid out again
+- (BOOL)layoutPrependedItems:(NSUInteger)count inSection:(NSInteger)section {
+    SMGridViewSection *sectionItems = [self itemsInSection:section];
+    if (sectionItems.numberOfRows != [self numberOfRowsInSection:section]) {
+        [sectionItems insertItemsInRange:NSMakeRange(0, count)];
+        return NO;
+    }
+    CGSize *sizes = malloc(MAX(count, 1) * sizeof(CGSize));
+    [self dataSourceSizes:sizes inSection:section range:NSMakeRange(0, count)];
+    [self invalidateSectionBounds];
+    BOOL laidOut = [sectionItems prependItemsWithSizes:sizes count:count flags:SMGridViewItemFlagSized params:[self layoutParams]];
+    free(sizes);
+    return laidOut;
+}
+
+// First laid out item of section with some part in [start, end) on the main axis, NSNotFound if none
+- (NSUInteger)firstItemInSection:(NSInteger)section from:(CGFloat)start to:(CGFloat)end {
+    __block NSUInteger ret = NSNotFound;
+    [[self itemsInSection:section] enumerateItemsFrom:start to:end vertical:self.vertical usingBlock:^(NSUInteger index, BOOL *stop) {
+        ret = MIN(ret, index);
+    }];
+    return ret;
+}
+
+- (CGFloat)mainAxisStartOfRect:(CGRect)rect {
+    return self.vertical ? CGRectGetMinY(rect) : CGRectGetMinX(rect);
+}
+
+- (void)prependItems:(NSUInteger)count toSection:(NSInteger)section {
+    if (!_sections) {
         [self reloadData];
         return;
     }
+    if (self.busy) {
+        [self enqueuePendingUpdate:^{
+            [self prependItems:count toSection:section];
+        }];
+        return;
+    }
     [self checkCorrectArrays];
-    NSMutableArray *items = [self itemsInSection:section];    
-    if (items.count == 0) {
-        [self resetPosArrays];
+    SMGridViewSection *sectionItems = [self itemsInSection:section];
+    NSUInteger oldCount = sectionItems.count;
+    if ((NSUInteger)[self numberOfItemsInSection:section] != oldCount + count) {
+        // Not only a prepend
         [self reloadSection:section];
         return;
     }
+    if (!sectionItems.laidOut || oldCount == 0) {
+        // Nothing to keep in place
+        [self layoutAppendedItems:count inSection:section];
+        return;
+    }
+    if (count == 0) {
+        return;
+    }
+    // Prefetched indexPaths point to other items now
+    [self cancelAllPrefetching];
     _reloadingData = YES;
-        
-    int count = [self numberOfItemsInSection:section];
-    // -1 because of header
-    for (int i = items.count -1; i < count; i++) {
-        NSIndexPath *indexPath = [NSIndexPath indexPathForRow:i inSection:section];
-        int row = [self findRowToInsertIndexPath:indexPath];
-        SMGridViewItem *item = [[[SMGridViewItem alloc] init] autorelease];
-        item.rect = [self calculateRectForIndexPath:indexPath row:row addIndexPath:nil];
-        item.indexPath = indexPath;
-        [items insertObject:item atIndex:i];
-        NSMutableArray *posArray = [self posArrayInSection:section];
-        [self updatePosArray:posArray row:row item:item];
+    [self invalidateLoadWindow];
+
+    // The first item on screen is the one that has to stay in place, in this section or in a later one.
+    // If an earlier section is at the top nothing on screen moves
+    CGFloat pos = self.vertical ? self.contentOffset.y : self.contentOffset.x;
+    CGFloat screen = self.vertical ? self.frame.size.height : self.frame.size.width;
+    CGFloat oldEnd = [self findMaxValueInSection:section];
+    // Sections ending right at pos are not on screen
+    [self updateSectionBounds];
+    NSInteger topSection = SMGridViewLayoutBoundsSearch(_sectionBounds, _sectionBoundsCount, pos, YES, NO);
+    NSInteger endSection = SMGridViewLayoutBoundsSearch(_sectionBounds, _sectionBoundsCount, pos + screen, NO, NO);
+    NSInteger anchorSection = section;
+    NSUInteger anchor = NSNotFound;
+    for (NSInteger i = topSection; i >= section && i < endSection && anchor == NSNotFound; i++) {
+        anchor = [self firstItemInSection:i from:pos to:pos + screen];
+        anchorSection = i;
+    }
+    CGFloat anchorStart = anchor != NSNotFound ? [self mainAxisStartOfRect:[[self itemsInSection:anchorSection] rectAtIndex:anchor]] : 0;
+
+    if (sectionItems.uniform || self.pagingEnabled) {
+        // Same size sections are laid out in constant time anyway
+        [sectionItems insertItemsInRange:NSMakeRange(0, count)];
+        [self layoutSection:section fromIndex:0 addIndexPath:nil];
+    } else if (![self layoutPrependedItems:count inSection:section]) {
+        // Sizes are kept, only the positions are computed again
+        [self layoutSection:section fromIndex:0 addIndexPath:nil];
+    }
+    for (int i = section + 1; i < _sections.count; i++) {
+        [self moveSectionToLayoutStart:i];
     }
-
     [self updateExtraViews:YES];
+
+    if (!self.pagingEnabled) {
+        CGFloat delta = 0;
+        // Items of the section moved count places, the ones of later sections kept their index
+        NSUInteger anchorRow = anchorSection == section ? anchor + count : anchor;
+        SMGridViewSection *anchorItems = [self itemsInSection:anchorSection];
+        if (anchor != NSNotFound && anchorRow < anchorItems.layoutCount) {
+            delta = [self mainAxisStartOfRect:[anchorItems rectAtIndex:anchorRow]] - anchorStart;
+        } else if (pos >= oldEnd) {
+            delta = [self findMaxValueInSection:section] - oldEnd;
+        }
+        if (delta != 0) {
+            // No load from scrollViewDidScroll:, there is one below
+            self.contentOffset = self.vertical ? CGPointMake(self.contentOffset.x, pos + delta) : CGPointMake(pos + delta, self.contentOffset.y);
+        }
+    }
     _reloadingData = NO;
     [self loadViewsForCurrentPos];
 }
 
+- (void)invalidateSizesInRange:(NSRange)range inSection:(NSInteger)section {
+    SMGridViewSection *sectionItems = [self itemsInSection:section];
+    if (!sectionItems.laidOut || range.location >= sectionItems.count) {
+        return;
+    }
+    if (self.busy) {
+        [self enqueuePendingUpdate:^{
+            [self invalidateSizesInRange:range inSection:section];
+        }];
+        return;
+    }
+    NSUInteger end = MIN(NSMaxRange(range), sectionItems.count);
+    for (NSUInteger i = range.location; i < end; i++) {
+        [sectionItems setFlags:[sectionItems flagsAtIndex:i] & ~SMGridViewItemFlagSized atIndex:i];
+    }
+    [self updateItemsFromIndexPath:[NSIndexPath indexPathForRow:range.location inSection:section] addIndexPath:nil updateContentSize:YES];
+    [self loadViewsForCurrentPos];
+}
+
+- (void)invalidateSizesInSection:(NSInteger)section {
+    [self invalidateSizesInRange:NSMakeRange(0, [self itemsInSection:section].count) inSection:section];
+}
+
+- (void)invalidateSizeAtIndexPath:(NSIndexPath *)indexPath {
+    [self invalidateSizesInRange:NSMakeRange(indexPath.row, 1) inSection:indexPath.section];
+}
+
 - (void)reloadDataWithPage:(NSInteger)page {
-    if ((_enableSort && _items) || self.busy) {
+    if (_enableSort && _sections) {
+        return;
+    }
+    if (self.busy) {
+        [self enqueuePendingUpdate:^{
+            [self reloadDataWithPage:page];
+        }];
         return;
     }
-    [self resetPosArrays];
     _reloadingData = YES;
-    [_bucketItems removeAllObjects];
     [self removeAllViews];
-    [_items release];
-    _items = nil;
+    [_sections release];
+    _sections = nil;
+    CFDictionaryRemoveAllValues(_viewSections);
+    [self invalidateSectionBounds];
     [self updateItems];
     if (page >= 0) {
         CGPoint offset = [self contentOffsetForPage:page];
@@ -1343,19 +3051,15 @@ typedef NSUInteger SMGridViewSortAnimSpeed;
 }
 
 - (void)reloadData {
-#ifdef kSMGridViewDebug
-    NSDate *date = [NSDate date];
-#endif
+    CFTimeInterval start = CACurrentMediaTime();
     [self reloadDataWithPage:-1];
-#ifdef kSMGridViewDebug
-    NSLog(@"reloadData:%f",[date timeIntervalSinceNow]);
-#endif
+    if (_traceEvents) {
+        [self traceSpan:SMGridViewTraceSpanReloadData section:-1 row:-1 start:start];
+    }
 }
 
 - (void)checkCorrectArrays {
-    for (int i = 0; i < [self numberOfSections] - _items.count; i++) {
-        [_items addObject:[NSMutableArray array]];
-    }
+    [self addMissingSections:[self numberOfSections]];
 }
 
 // Special method to do fast infinite scrolling
@@ -1363,18 +3067,20 @@ typedef NSUInteger SMGridViewSortAnimSpeed;
     if ([self numberOfSections] > 0) {
         [self reloadSectionOnlyNew:[self numberOfSections]-1];
     } else {
-        [self reloadData]; 
+        [self reloadData];
     }
 }
 
 - (NSArray *)currentViews:(BOOL)includeHeaders {
     NSMutableArray *ret = [NSMutableArray array];
-    [self loopItems:^(SMGridViewItem *item) {
-        if ((!item.header || includeHeaders) && item.view) {
-            [ret addObject:item.view];
+    [self loopVisibleItems:^(SMGridViewItemRef item, UIView *view, BOOL *stop) {
+        if ((!item.header || includeHeaders) && ![self isPlaceholderItem:item]) {
+            [ret addObject:view];
         }
     }];
-    [ret addObjectsFromArray:_reusableViews];
+    [self enumerateReusePools:^(SMGridViewReusePool *pool) {
+        [ret addObjectsFromArray:pool.views];
+    }];
     return ret;
 }
 
@@ -1383,7 +3089,7 @@ typedef NSUInteger SMGridViewSortAnimSpeed;
 }
 
 - (UIView *)headerViewForSection:(NSInteger)section {
-    return [self headerItemInSection:section].view;
+    return [self itemsInSection:section].headerView;
 }
 
 #pragma mark - Adding/Removing items
@@ -1425,31 +3131,31 @@ typedef NSUInteger SMGridViewSortAnimSpeed;
 }
 
 - (BOOL)isLastIndexPath:(NSIndexPath *)indexPath {
-    return indexPath.section == _items.count && indexPath.row == [(NSArray *)[_items objectAtIndex:indexPath.section] count] -1;
+    return indexPath.section == (NSInteger)_sections.count - 1 && indexPath.row == (NSInteger)[self itemsInSection:indexPath.section].count - 1;
 }
 
 - (void)finishAddingIndexPath:(NSIndexPath *)indexPath {
     [indexPath retain];
     self.addingIndexPath = nil;
-    [self updateItemsAddIndexPath:indexPath];
+    [self updateItemsFromIndexPath:indexPath addIndexPath:indexPath updateContentSize:YES];
     BOOL shouldAnimateOthers = ![self isLastIndexPath:indexPath];
     [UIView animateWithDuration:shouldAnimateOthers?kSMTVanimDuration:0 delay:0 options:0 animations:^(void) {
         [self loadViewsForCurrentPos];
-        SMGridViewItem *item = [self itemAtIndexPath:indexPath];
-        item.view.hidden = YES;
+        [self viewForIndexPath:indexPath].hidden = YES;
     } completion:^(BOOL finished) {
-        SMGridViewItem *item = [self itemAtIndexPath:indexPath];
-        item.view.alpha = 0.0;
-        item.view.hidden = NO;
+        UIView *view = [self viewForIndexPath:indexPath];
+        view.alpha = 0.0;
+        view.hidden = NO;
         [UIView animateWithDuration:kSMTVanimDuration delay:0 options:0 animations:^(void) {
-            item.view.alpha = 1.0;
+            view.alpha = 1.0;
         } completion:^(BOOL finished) {
-            item.toAdd = NO;
+            [self setToAdd:NO forItem:[self itemForIndexPath:indexPath]];
             if ([_gridDelegate respondsToSelector:@selector(smGridView:didFinishAddingIndexPath:)]) {
                 [_gridDelegate smGridView:self didFinishAddingIndexPath:indexPath];
             }
             _addingOrRemoving = NO;
             [indexPath release];
+            [self performPendingUpdates];
         }];
     }];
 }
@@ -1460,6 +3166,9 @@ typedef NSUInteger SMGridViewSortAnimSpeed;
 
 - (void)addItemAtIndexPath:(NSIndexPath *)indexPath scroll:(BOOL)scroll {
     if (_addingOrRemoving) {
+        [self enqueuePendingUpdate:^{
+            [self addItemAtIndexPath:indexPath scroll:scroll];
+        }];
         return;
     }
     _addingOrRemoving = YES;
@@ -1473,9 +3182,8 @@ typedef NSUInteger SMGridViewSortAnimSpeed;
             [self setContentOffset:offset animated:YES];
         }
     }else {
-        SMGridViewItem *item = [self itemAtIndexPath:indexPath];
         // Center scroll
-        CGRect rect = item.rect;
+        CGRect rect = [self rectForIndexPath:indexPath];
         if (self.vertical) {
             rect.origin.y = rect.origin.y - (self.frame.size.height - rect.size.height)/2;
             if (rect.origin.y + self.frame.size.height > (self.contentSize.height + rect.size.height)) {
@@ -1509,46 +3217,43 @@ typedef NSUInteger SMGridViewSortAnimSpeed;
 }
 
 - (void)deleteItemAtIndexPath:(NSIndexPath *)indexPath {
-    if (indexPath.section < _items.count) {
-        NSMutableArray *items = [_items objectAtIndex:indexPath.section];
-        if (indexPath.row < items.count) {
-            [items removeObjectAtIndex:indexPath.row];
-        }
+    SMGridViewSection *sectionItems = [self itemsInSection:indexPath.section];
+    if (indexPath.row < sectionItems.count) {
+        [sectionItems removeItemAtIndex:indexPath.row];
     }
 }
 
 - (void)finishRemovingIndexPath:(NSIndexPath *)indexPath {
     NSMutableArray *addedIndexes = [NSMutableArray array];
-    SMGridViewItem *item = [self itemAtIndexPath:indexPath];
     [UIView animateWithDuration:kSMTVanimDuration delay:0 options:0 animations:^(void) {
-        item.view.alpha = 0.0;
-        item.view.transform = CGAffineTransformMakeScale(0.1, 0.1);
+        UIView *view = [self viewForIndexPath:indexPath];
+        view.alpha = 0.0;
+        view.transform = CGAffineTransformMakeScale(0.1, 0.1);
     } completion:^(BOOL finished) {
-        [item.view removeFromSuperview];
-        item.view = nil;
+        [[self viewForIndexPath:indexPath] removeFromSuperview];
+        [self setView:nil forItem:[self itemForIndexPath:indexPath]];
         if ([_dataSource respondsToSelector:@selector(smGridView:performRemoveIndexPath:)]) {
             [_dataSource smGridView:self performRemoveIndexPath:indexPath];
         }
         [self deleteItemAtIndexPath:indexPath];
-        [self updateItemsAddIndexPath:nil updateContentSize:NO];
+        [self updateItemsFromIndexPath:indexPath addIndexPath:nil updateContentSize:NO];
         [UIView animateWithDuration:kSMTVanimDuration delay:0 options:0 animations:^(void) {
             [self loadViewsForCurrentPosAddedIndexes:addedIndexes];
             [self updateContentSize];
             for (NSIndexPath *addedIndexPath in addedIndexes) {
-                SMGridViewItem *item = [self itemAtIndexPath:addedIndexPath];
-                item.view.hidden = YES;
+                [self viewForIndexPath:addedIndexPath].hidden = YES;
             }
         } completion:^(BOOL finished) {
             // We need this extra load to prevent issues with animating contentSize
             [self loadViewsForCurrentPosAddedIndexes:addedIndexes];
             for (NSIndexPath *addedIndexPath in addedIndexes) {
-                SMGridViewItem *item = [self itemAtIndexPath:addedIndexPath];
-                item.view.hidden = NO;
+                [self viewForIndexPath:addedIndexPath].hidden = NO;
             }
             if ([_gridDelegate respondsToSelector:@selector(smGridView:didFinishRemovingIndexPath:)]) {
                 [_gridDelegate smGridView:self didFinishRemovingIndexPath:indexPath];
             }
             _addingOrRemoving = NO;
+            [self performPendingUpdates];
         }];
     }];
 }
@@ -1558,10 +3263,13 @@ typedef NSUInteger SMGridViewSortAnimSpeed;
 }
 
 - (void)removeItemAtIndexPath:(NSIndexPath *)indexPath scroll:(BOOL)scroll {
-    if (_addingOrRemoving || (indexPath.row == _draggingOrigItemsIndex && indexPath.section == _draggingSection)) {
+    if (indexPath.row == _draggingOrigItemsIndex && indexPath.section == _draggingSection) {
         return;
     }
     if (_addingOrRemoving) {
+        [self enqueuePendingUpdate:^{
+            [self removeItemAtIndexPath:indexPath scroll:scroll];
+        }];
         return;
     }
     _addingOrRemoving = YES;
@@ -1574,20 +3282,20 @@ typedef NSUInteger SMGridViewSortAnimSpeed;
             [self setContentOffset:offset animated:YES];
         }
     }else {
-        SMGridViewItem *item = [self itemAtIndexPath:indexPath];
-        if ([self rectIsVisible:item.rect] || !scroll) {
+        CGRect rect = [self rectForIndexPath:indexPath];
+        if ([self rectIsVisible:rect] || !scroll) {
             [self finishRemovingIndexPath:indexPath];
         }else {
             self.removingIndexPath = indexPath;
-//            [self scrollRectToVisible:item.rect animated:YES];
-            [self scrollToRectHeaderAware:item.rect animated:YES];
+//            [self scrollRectToVisible:rect animated:YES];
+            [self scrollToRectHeaderAware:rect animated:YES];
         }
     }
-} 
+}
 
 - (CGRect)rectForSection:(NSInteger)section {
-    float max = [self findMaxValueInSection:section];
-    float min = [self findMinValueInSection:section];
+    CGFloat max = [self findMaxValueInSection:section];
+    CGFloat min = [self findMinValueInSection:section];
     if (self.vertical) {
         return CGRectMake(0, min, self.frame.size.width, max - min);
     } else {
@@ -1596,16 +3304,321 @@ typedef NSUInteger SMGridViewSortAnimSpeed;
 }
 
 
-#pragma mark - EmptyView
+#pragma mark - Batch updates
 
-- (int)totalItemsCountNoHeader {
-    int ret = 0;
-    for (NSArray *items in _items) {
-        for (SMGridViewItem *item in items) {
+- (void)enqueuePendingUpdate:(void (^)(void))update {
+    if (!self.pendingUpdates) {
+        self.pendingUpdates = [NSMutableArray array];
+    }
+    void (^copiedUpdate)(void) = [update copy];
+    [self.pendingUpdates addObject:copiedUpdate];
+    [copiedUpdate release];
+}
+
+- (void)performPendingUpdates {
+    while (self.pendingUpdates.count > 0 && !self.busy) {
+        void (^update)(void) = [[self.pendingUpdates objectAtIndex:0] retain];
+        [self.pendingUpdates removeObjectAtIndex:0];
+        update();
+        [update release];
+    }
+}
+
+- (void)performBatchUpdates:(void (^)(void))updates completion:(void (^)(BOOL finished))completion {
+    if (self.batch) {
+        // Nested, everything goes to the running batch
+        if (updates) {
+            updates();
+        }
+        if (completion) {
+            [self.batch.completions addObject:[[completion copy] autorelease]];
+        }
+        return;
+    }
+    if (self.busy) {
+        [self enqueuePendingUpdate:^{
+            [self performBatchUpdates:updates completion:completion];
+        }];
+        return;
+    }
+    SMGridViewBatch *batch = [[SMGridViewBatch alloc] init];
+    self.batch = batch;
+    if (updates) {
+        updates();
+    }
+    if (completion) {
+        [batch.completions addObject:[[completion copy] autorelease]];
+    }
+    self.batch = nil;
+    if (_sections) {
+        [self applyBatch:batch];
+    } else {
+        [self reloadData];
+        [self finishBatch:batch finished:YES];
+    }
+    [batch release];
+}
+
+- (void)reloadDataWithUpdates:(void (^)(void))updates completion:(void (^)(BOOL finished))completion {
+    if (!_sections || ![_dataSource respondsToSelector:@selector(smGridView:identifiersForItemsInSection:)]) {
+        // Nothing to compare with
+        [self performBatchUpdates:^{
+            if (updates) {
+                updates();
+            }
+            [self.batch.reloadedSections addIndexesInRange:NSMakeRange(0, _sections.count)];
+        } completion:completion];
+        return;
+    }
+    [self performBatchUpdates:^{
+        // Read when the batch runs, it may have been queued
+        NSUInteger numberOfSections = _sections.count;
+        NSMutableArray *oldIdentifiers = [NSMutableArray arrayWithCapacity:numberOfSections];
+        // Without tokens there is no telling what changed, every kept view on screen is asked again
+        BOOL hasTokens = [_dataSource respondsToSelector:@selector(smGridView:contentTokensForItemsInSection:)];
+        NSMutableArray *oldTokens = hasTokens ? [NSMutableArray arrayWithCapacity:numberOfSections] : nil;
+        self.batch.reloadsVisibleItems = !hasTokens;
+        for (NSUInteger section = 0; section < numberOfSections; section++) {
+            NSArray *identifiers = [_dataSource smGridView:self identifiersForItemsInSection:section];
+            [oldIdentifiers addObject:identifiers ? identifiers : [NSArray array]];
+            if (hasTokens) {
+                NSArray *tokens = [_dataSource smGridView:self contentTokensForItemsInSection:section];
+                [oldTokens addObject:tokens ? tokens : [NSArray array]];
+            }
+        }
+        if (updates) {
+            updates();
+        }
+        if ([self numberOfSections] != numberOfSections) {
+            [self.batch.reloadedSections addIndexesInRange:NSMakeRange(0, numberOfSections)];
+            return;
+        }
+        for (NSUInteger section = 0; section < numberOfSections; section++) {
+            NSArray *identifiers = [_dataSource smGridView:self identifiersForItemsInSection:section];
+            NSArray *tokens = hasTokens ? [_dataSource smGridView:self contentTokensForItemsInSection:section] : nil;
+            [self.batch addChangesFromIdentifiers:[oldIdentifiers objectAtIndex:section] toIdentifiers:identifiers ? identifiers : [NSArray array]
+                                        oldTokens:hasTokens ? [oldTokens objectAtIndex:section] : nil newTokens:tokens inSection:section];
+        }
+    } completion:completion];
+}
+
+- (void)insertItemsAtIndexPaths:(NSArray *)indexPaths {
+    [self performBatchUpdates:^{
+        [self.batch.insertedIndexPaths addObjectsFromArray:indexPaths];
+    } completion:nil];
+}
+
+- (void)deleteItemsAtIndexPaths:(NSArray *)indexPaths {
+    [self performBatchUpdates:^{
+        [self.batch.deletedIndexPaths addObjectsFromArray:indexPaths];
+    } completion:nil];
+}
+
+- (void)moveItemAtIndexPath:(NSIndexPath *)indexPath toIndexPath:(NSIndexPath *)newIndexPath {
+    [self performBatchUpdates:^{
+        [self.batch.movedFromIndexPaths addObject:indexPath];
+        [self.batch.movedToIndexPaths addObject:newIndexPath];
+    } completion:nil];
+}
+
+- (void)reloadSections:(NSIndexSet *)sections {
+    [self performBatchUpdates:^{
+        [self.batch.reloadedSections addIndexes:sections];
+    } completion:nil];
+}
+
+- (SMGridViewBatchOp *)batchOpsWithIndexPaths:(NSArray *)indexPaths moves:(NSArray *)moves count:(NSUInteger *)count {
+    *count = indexPaths.count + moves.count;
+    SMGridViewBatchOp *ops = malloc(MAX(*count, 1) * sizeof(SMGridViewBatchOp));
+    NSUInteger i = 0;
+    for (NSIndexPath *indexPath in indexPaths) {
+        SMGridViewBatchOp op = {indexPath.section, indexPath.row, -1};
+        ops[i++] = op;
+    }
+    NSInteger move = 0;
+    for (NSIndexPath *indexPath in moves) {
+        SMGridViewBatchOp op = {indexPath.section, indexPath.row, move++};
+        ops[i++] = op;
+    }
+    qsort(ops, *count, sizeof(SMGridViewBatchOp), SMGridViewBatchOpCompare);
+    return ops;
+}
+
+- (void)applyBatch:(SMGridViewBatch *)batch {
+    _addingOrRemoving = YES;
+    NSUInteger numberOfSections = _sections.count;
+    NSUInteger *changedRows = malloc(MAX(numberOfSections, 1) * sizeof(NSUInteger));
+    for (NSUInteger section = 0; section < numberOfSections; section++) {
+        changedRows[section] = NSNotFound;
+    }
+    NSIndexSet *reloadedSections = batch.reloadedSections;
+
+    // Reloaded sections are built again from the dataSource
+    for (NSUInteger section = 0; section < numberOfSections; section++) {
+        if ([reloadedSections containsIndex:section]) {
+            [self removeAllViewsInSection:section];
+            [self resetItemsInSection:section];
+            changedRows[section] = 0;
+        }
+    }
+
+    // Deletes and move sources use old indexPaths, remove them from the end
+    NSUInteger count = 0;
+    NSUInteger movesCount = batch.movedFromIndexPaths.count;
+    SMGridViewMovedItem *movedItems = calloc(MAX(movesCount, 1), sizeof(SMGridViewMovedItem));
+    NSMutableArray *removedViews = [NSMutableArray array];
+    SMGridViewBatchOp *ops = [self batchOpsWithIndexPaths:batch.deletedIndexPaths moves:batch.movedFromIndexPaths count:&count];
+    for (NSInteger i = count - 1; i >= 0; i--) {
+        SMGridViewBatchOp op = ops[i];
+        SMGridViewSection *sectionItems = [self itemsInSection:op.section];
+        if (!sectionItems || [reloadedSections containsIndex:op.section] || op.row < 0 || op.row >= sectionItems.count) {
+            continue;
+        }
+        UIView *view = [sectionItems viewAtIndex:op.row];
+        if (op.move >= 0) {
+            movedItems[op.move].rect = [sectionItems rectAtIndex:op.row];
+            movedItems[op.move].flags = [sectionItems flagsAtIndex:op.row];
+            movedItems[op.move].view = view;
+            movedItems[op.move].section = op.section;
+            movedItems[op.move].valid = YES;
+        } else if (view) {
+            [removedViews addObject:view];
+            CFDictionaryRemoveValue(_viewSections, view);
+        }
+        [sectionItems removeItemAtIndex:op.row];
+        changedRows[op.section] = MIN(changedRows[op.section], op.row);
+    }
+    free(ops);
+
+    // Inserts and move destinations use new indexPaths, add them from the start
+    NSMutableArray *insertedIndexPaths = [NSMutableArray array];
+    ops = [self batchOpsWithIndexPaths:batch.insertedIndexPaths moves:batch.movedToIndexPaths count:&count];
+    for (NSUInteger i = 0; i < count; i++) {
+        SMGridViewBatchOp op = ops[i];
+        SMGridViewSection *sectionItems = [self itemsInSection:op.section];
+        if (!sectionItems || [reloadedSections containsIndex:op.section] || op.row < 0 || op.row > sectionItems.count) {
+            continue;
+        }
+        [sectionItems insertItemAtIndex:op.row];
+        if (op.move >= 0 && movedItems[op.move].valid) {
+            SMGridViewMovedItem moved = movedItems[op.move];
+            [sectionItems setRect:moved.rect atIndex:op.row];
+            // A size is only valid inside its section
+            [sectionItems setFlags:(moved.section == op.section ? moved.flags : 0) atIndex:op.row];
+            [sectionItems setView:moved.view atIndex:op.row];
+            if (moved.view) {
+                CFDictionarySetValue(_viewSections, moved.view, sectionItems);
+            }
+            movedItems[op.move].placed = YES;
+        } else {
+            [sectionItems setFlags:SMGridViewItemFlagToAdd atIndex:op.row];
+            [insertedIndexPaths addObject:[NSIndexPath indexPathForRow:op.row inSection:op.section]];
+        }
+        changedRows[op.section] = MIN(changedRows[op.section], op.row);
+    }
+    free(ops);
+    // Destinations in a reloaded section or out of range don't take their view, nothing else would remove it
+    for (NSUInteger i = 0; i < movesCount; i++) {
+        if (movedItems[i].valid && !movedItems[i].placed && movedItems[i].view) {
+            [removedViews addObject:movedItems[i].view];
+            CFDictionaryRemoveValue(_viewSections, movedItems[i].view);
+        }
+    }
+    free(movedItems);
+
+    // Kept items whose content changed are sized again and get a new view once laid out
+    NSMutableArray *refreshedIndexPaths = [NSMutableArray array];
+    if (batch.reloadsVisibleItems) {
+        [self loopVisibleItems:^(SMGridViewItemRef item, UIView *view, BOOL *stop) {
             if (!item.header) {
-                ret++;
+                [refreshedIndexPaths addObject:[self indexPathForItem:item]];
+            }
+        }];
+    } else {
+        [refreshedIndexPaths addObjectsFromArray:batch.reloadedIndexPaths];
+    }
+    for (NSUInteger i = refreshedIndexPaths.count; i > 0; i--) {
+        NSIndexPath *indexPath = [refreshedIndexPaths objectAtIndex:i - 1];
+        SMGridViewSection *sectionItems = [self itemsInSection:indexPath.section];
+        if (!sectionItems || indexPath.row >= sectionItems.count) {
+            [refreshedIndexPaths removeObjectAtIndex:i - 1];
+            continue;
+        }
+        SMGridViewItemRef item = [self itemForIndexPath:indexPath];
+        UIView *view = [self viewForItem:item];
+        if (!view || view == _draggingView || [self isPlaceholderItem:item]) {
+            // Views created later ask the dataSource anyway
+            [refreshedIndexPaths removeObjectAtIndex:i - 1];
+            continue;
+        }
+        [sectionItems setFlags:[sectionItems flagsAtIndex:indexPath.row] & ~SMGridViewItemFlagSized atIndex:indexPath.row];
+        changedRows[indexPath.section] = MIN(changedRows[indexPath.section], indexPath.row);
+    }
+
+    [self layoutItemsWithChangedRows:changedRows addIndexPath:nil];
+    free(changedRows);
+    [self updateExtraViews:NO];
+    for (NSIndexPath *indexPath in refreshedIndexPaths) {
+        SMGridViewItemRef item = [self itemForIndexPath:indexPath];
+        [self queView:item];
+        [self materializeItem:item addedIndexes:nil];
+    }
+
+    NSMutableArray *addedIndexes = [NSMutableArray array];
+    [UIView animateWithDuration:kSMTVanimDuration delay:0 options:0 animations:^(void) {
+        for (UIView *view in removedViews) {
+            view.alpha = 0.0;
+            view.transform = CGAffineTransformMakeScale(0.1, 0.1);
+        }
+        [self loadViewsForCurrentPosAddedIndexes:addedIndexes];
+        [self updateContentSize];
+        for (NSIndexPath *addedIndexPath in addedIndexes) {
+            [self viewForIndexPath:addedIndexPath].hidden = YES;
+        }
+    } completion:^(BOOL finished) {
+        for (UIView *view in removedViews) {
+            [view removeFromSuperview];
+        }
+        // We need this extra load to prevent issues with animating contentSize
+        [self loadViewsForCurrentPosAddedIndexes:addedIndexes];
+        NSMutableArray *insertedViews = [NSMutableArray array];
+        for (NSIndexPath *insertedIndexPath in insertedIndexPaths) {
+            [self setToAdd:NO forItem:[self itemForIndexPath:insertedIndexPath]];
+            UIView *view = [self viewForIndexPath:insertedIndexPath];
+            if (view) {
+                view.alpha = 0.0;
+                view.hidden = NO;
+                [insertedViews addObject:view];
             }
         }
+        for (NSIndexPath *addedIndexPath in addedIndexes) {
+            [self viewForIndexPath:addedIndexPath].hidden = NO;
+        }
+        [UIView animateWithDuration:kSMTVanimDuration delay:0 options:0 animations:^(void) {
+            for (UIView *view in insertedViews) {
+                view.alpha = 1.0;
+            }
+        } completion:^(BOOL finished) {
+            _addingOrRemoving = NO;
+            [self finishBatch:batch finished:finished];
+        }];
+    }];
+}
+
+- (void)finishBatch:(SMGridViewBatch *)batch finished:(BOOL)finished {
+    for (void (^completion)(BOOL) in batch.completions) {
+        completion(finished);
+    }
+    [self performPendingUpdates];
+}
+
+
+#pragma mark - EmptyView
+
+- (int)totalItemsCountNoHeader {
+    int ret = 0;
+    for (SMGridViewSection *sectionItems in _sections) {
+        ret += sectionItems.count;
     }
     return ret;
 }
@@ -1614,7 +3627,7 @@ typedef NSUInteger SMGridViewSortAnimSpeed;
     if (emptyView == _emptyView) {
         return;
     }
-    
+
     [_emptyView removeFromSuperview];
     _emptyView = [emptyView retain];
     [self updateEmptyView];
@@ -1696,18 +3709,16 @@ typedef NSUInteger SMGridViewSortAnimSpeed;
     if ([_gridDelegate respondsToSelector:@selector(smGridView:stopDraggingView:atIndex:)]) {
         [_gridDelegate smGridView:self stopDraggingView:_draggingView atIndex:_draggingOrigItemsIndex];
     }
-    [self.dragAnimTimer invalidate];
-    self.dragAnimTimer = nil;
+    [self stopDragScroll];
     [self.dragPageAnimTimer invalidate];
     self.dragPageAnimTimer = nil;
     [self.dragStartAnimTimer invalidate];
     self.dragStartAnimTimer = nil;
-    NSArray *items = [self itemsInSection:_draggingSection];
     [UIView animateWithDuration:0.2 animations:^{
-        SMGridViewItem *item = [items objectAtIndex:_draggingItemsIndex];
-        controlView.frame = item.rect;
+        SMGridViewItemRef item = SMGridViewItemRefMake(_draggingSection, _draggingItemsIndex);
+        controlView.frame = [self rectForItem:item];
         if (self.pagingEnabled) {
-            [self setContentOffset:[self contentOffsetForPage:[self pageForIndexPath:item.indexPath]] animated:YES];
+            [self setContentOffset:[self contentOffsetForPage:[self pageForItem:item]] animated:YES];
         } else {
             [self scrollRectToVisible:controlView.frame animated:YES];
         }
@@ -1718,38 +3729,46 @@ typedef NSUInteger SMGridViewSortAnimSpeed;
             }
         }
         [self sendSubviewToBack:self.draggingView];
+        [self invalidateLoadWindow];
         _draggingSection = -1;
         _draggingOrigItemsIndex = -1;
         _draggingItemsIndex = -1;
         self.draggingView = nil;
+        [self performPendingUpdates];
     }];
 }
 
 - (int)findDraggingPosition:(UIControl *)controlView {
-    float retDistance = FLT_MAX;
-    int ret = -1;
-    int i = 0;
-    NSArray *items = [self itemsInSection:_draggingSection];
-    if (_draggingOrigItemsIndex >= items.count) {
+    __block CGFloat retDistance = FLT_MAX;
+    __block int ret = -1;
+    SMGridViewSection *sectionItems = [self itemsInSection:_draggingSection];
+    if (_draggingOrigItemsIndex >= sectionItems.count) {
         return _draggingOrigItemsIndex;
     }
-    float currentDistance = CGPointDistance(controlView.center, [[items objectAtIndex:_draggingItemsIndex] centerPoint]);
-    for (SMGridViewItem *item in items) {
-        if (!item.header) {
-            float distance = CGPointDistance(controlView.center,item.centerPoint);
-            if (distance < retDistance && distance < currentDistance -20) {
-                retDistance = distance;
-                ret = i;
-            }
-        }
-        i++;
+    CGRect currentRect = [sectionItems rectAtIndex:_draggingItemsIndex];
+    CGPoint center = controlView.center;
+    CGFloat currentDistance = CGPointDistance(center, CGPointMake(CGRectGetMidX(currentRect), CGRectGetMidY(currentRect)));
+    // Only slots whose center is closer than currentDistance - 20 count, and a center is inside its rect,
+    // so the index gives every candidate: the items crossing that radius on the main axis
+    CGFloat radius = currentDistance - 20;
+    if (radius <= 0) {
+        return ret;
     }
+    CGFloat mainCenter = self.vertical ? center.y : center.x;
+    [sectionItems enumerateItemsFrom:mainCenter - radius to:mainCenter + radius vertical:self.vertical usingBlock:^(NSUInteger index, BOOL *stop) {
+        CGRect rect = [sectionItems rectAtIndex:index];
+        CGFloat distance = CGPointDistance(center, CGPointMake(CGRectGetMidX(rect), CGRectGetMidY(rect)));
+        if (distance < retDistance && distance < radius) {
+            retDistance = distance;
+            ret = index;
+        }
+    }];
     return ret;
 }
 
 - (CGRect)draggingAnimRectForSection:(NSInteger)section {
-    float max = [self findMaxValueInSection:section];
-    float min = [self findMinValueInSectionHeaderAware:section];
+    CGFloat max = [self findMaxValueInSection:section];
+    CGFloat min = [self findMinValueInSectionHeaderAware:section];
     if (self.vertical) {
         return CGRectMake(0, min, self.frame.size.width, max - min);
     } else {
@@ -1757,73 +3776,94 @@ typedef NSUInteger SMGridViewSortAnimSpeed;
     }
 }
 
-- (void)moveEnd {
-    CGRect rect = [self draggingAnimRectForSection:_draggingSection];
-    float pxMove = [self calculateDraggingPxMove];
-    if (self.vertical) {
-        if (self.contentOffset.y <= CGRectGetMaxY(rect) - _draggingView.frame.size.height - self.contentInset.top) {
-            [self setContentOffset:CGPointMake(0, self.contentOffset.y + pxMove) animated:NO];
-            
-            [self calculatePositionsDragTimer];
-        } 
-    } else {
-        if (self.contentOffset.x <= CGRectGetMaxX(rect) - _draggingView.frame.size.width - self.contentInset.left) {
-            [self setContentOffset:CGPointMake(self.contentOffset.x + pxMove, 0) animated:NO];
-            
-            [self calculatePositionsDragTimer];
-        }
-    }
+// Speed in points per second, faster closer to the edge and the longer it has been scrolling
+- (CGFloat)dragScrollSpeedWithDistance:(CGFloat)distance elapsed:(CFTimeInterval)elapsed {
+    CGFloat closeness = 1 - MAX(0, MIN(distance, kSMdefaultDragScrollEdge)) / kSMdefaultDragScrollEdge;
+    CGFloat ramp = MIN(1, elapsed / kSMdefaultDragScrollRampTime);
+    return kSMdefaultDragScrollMaxSpeed * (0.1 + 0.9 * closeness * closeness) * (0.25 + 0.75 * ramp);
 }
 
-- (void)moveStart {
-    CGRect rect = [self draggingAnimRectForSection:_draggingSection];
-    float pxMove = [self calculateDraggingPxMove];
+// Distance from the dragged view center to the closest edge of the screen, end is YES for the bottom (or right) one
+- (CGFloat)draggingDistanceToEdge:(BOOL *)end {
+    CGFloat distanceToEnd = 0;
+    CGFloat distanceToStart = 0;
     if (self.vertical) {
-        if (self.contentOffset.y + self.contentInset.top > CGRectGetMinY(rect)) {
-            [self setContentOffset:CGPointMake(0, self.contentOffset.y - pxMove) animated:NO];
-            
-            [self calculatePositionsDragTimer];
-        }
+        distanceToEnd  = self.frame.size.height -_draggingView.center.y + self.contentOffset.y;
+        distanceToStart  = _draggingView.center.y - self.contentOffset.y;
     } else {
-        if (self.contentOffset.x + self.contentInset.left > CGRectGetMinY(rect)) {
-            [self setContentOffset:CGPointMake(self.contentOffset.x - pxMove, 0) animated:NO];
-            
-            [self calculatePositionsDragTimer];
-        }
+        distanceToEnd  = self.frame.size.width -_draggingView.center.x + self.contentOffset.x;
+        distanceToStart  = _draggingView.center.x - self.contentOffset.x;
     }
+    *end = distanceToEnd <= distanceToStart;
+    return MIN(distanceToEnd, distanceToStart);
 }
 
-- (SMGridViewSortAnimSpeed)calculateDraggingSpeedWithGap:(float)gap {
-    if (gap < 10) {
-        return SMGridViewSortAnimSpeedFast;
-    } else if (gap < 50) {
-        return SMGridViewSortAnimSpeedMid;
-    } else {
-        return SMGridViewSortAnimSpeedSlow;
+- (void)startDragScroll {
+    if (_dragDisplayLink) {
+        return;
     }
+    _dragScrollStartTime = CACurrentMediaTime();
+    _dragScrollLastTime = _dragScrollStartTime;
+    // The frames evaluate the drop target from now on, a pending debounce is taken over by the first one
+    _dragTargetDirty = self.dragStartAnimTimer.isValid;
+    [self.dragStartAnimTimer invalidate];
+    self.dragStartAnimTimer = nil;
+    self.dragDisplayLink = [CADisplayLink displayLinkWithTarget:self selector:@selector(dragScrollFrame:)];
+    [self.dragDisplayLink addToRunLoop:[NSRunLoop mainRunLoop] forMode:NSRunLoopCommonModes];
 }
 
-- (float)calculateDraggingInterval {
-    switch (_draggingSpeed) {
-        case SMGridViewSortAnimSpeedFast:
-            return 0.01;
-        case SMGridViewSortAnimSpeedMid:
-            return 0.01;
-        case SMGridViewSortAnimSpeedSlow:
-        default:
-            return 0.01;
-    }
+- (void)stopDragScroll {
+    // The display link retains the grid, it has to be invalidated before it can go away
+    [self.dragDisplayLink invalidate];
+    self.dragDisplayLink = nil;
 }
 
-- (float)calculateDraggingPxMove {
-    switch (_draggingSpeed) {
-        case SMGridViewSortAnimSpeedFast:
-            return 8;
-        case SMGridViewSortAnimSpeedMid:
-            return 3;
-        case SMGridViewSortAnimSpeedSlow:
-        default:
-            return 1;
+// One step per frame: move the offset by what the speed gives for the frame time, then a single
+// drop target evaluation and a single load pass
+- (void)dragScrollFrame:(CADisplayLink *)displayLink {
+    BOOL end = NO;
+    CGFloat distance = [self draggingDistanceToEdge:&end];
+    if (!_draggingView || self.pagingEnabled || distance >= kSMdefaultDragScrollEdge) {
+        [self stopDragScroll];
+        if (_draggingView && _dragTargetDirty) {
+            // Back to the debounce of dragInside:withEvent:
+            [self calculatePositionsDragTimer];
+        }
+        _dragTargetDirty = NO;
+        return;
+    }
+    CFTimeInterval now = displayLink.timestamp;
+    CFTimeInterval frameTime = MIN(MAX(now - _dragScrollLastTime, 0), kSMdefaultDragScrollMaxFrameTime);
+    _dragScrollLastTime = now;
+    CGFloat delta = [self dragScrollSpeedWithDistance:distance elapsed:now - _dragScrollStartTime] * frameTime;
+
+    // Never further than the dragged section
+    CGRect rect = [self draggingAnimRectForSection:_draggingSection];
+    CGFloat pos = self.vertical ? self.contentOffset.y : self.contentOffset.x;
+    CGFloat newPos;
+    if (end) {
+        CGFloat limit = self.vertical ? CGRectGetMaxY(rect) - self.frame.size.height + self.contentInset.bottom : CGRectGetMaxX(rect) - self.frame.size.width + self.contentInset.right;
+        newPos = MAX(pos, MIN(pos + delta, limit));
+    } else {
+        CGFloat limit = self.vertical ? CGRectGetMinY(rect) - self.contentInset.top : CGRectGetMinX(rect) - self.contentInset.left;
+        newPos = MIN(pos, MAX(pos - delta, limit));
+    }
+    BOOL moved = newPos != pos;
+    if (moved) {
+        // scrollViewDidScroll: moves the dragged view along but leaves the load pass to this frame
+        _dragScrollingFrame = YES;
+        self.contentOffset = self.vertical ? CGPointMake(self.contentOffset.x, newPos) : CGPointMake(newPos, self.contentOffset.y);
+        _dragScrollingFrame = NO;
+    }
+    if (moved || _dragTargetDirty) {
+        _dragTargetDirty = NO;
+        // Right away, the frames are the debounce. A move loads views itself, animated
+        if (![self calculatePositionsDrag] && moved) {
+            [CATransaction begin];
+            [CATransaction setDisableActions:YES];
+            [self loadViewsForCurrentPos];
+            [CATransaction commit];
+        }
     }
 }
 
@@ -1851,73 +3891,43 @@ typedef NSUInteger SMGridViewSortAnimSpeed;
 }
 
 - (void)handleScrollAnimation {
-    float distanceToEnd = 0;
-    float distanceToStart = 0;
-    if (self.vertical) {
-        distanceToEnd  = self.frame.size.height -_draggingView.center.y + self.contentOffset.y;
-        distanceToStart  = _draggingView.center.y - self.contentOffset.y;
-    } else {
-        distanceToEnd  = self.frame.size.width -_draggingView.center.x + self.contentOffset.x;
-        distanceToStart  = _draggingView.center.x - self.contentOffset.x;
-    }
-    if (distanceToEnd < 100) {
+    BOOL end = NO;
+    if ([self draggingDistanceToEdge:&end] < kSMdefaultDragScrollEdge) {
         if (self.pagingEnabled) {
-            [self changePageTimer:YES interval:.5];
+            [self changePageTimer:end interval:.5];
         } else {
-            SMGridViewSortAnimSpeed newSpeed = [self calculateDraggingSpeedWithGap:distanceToEnd];
-            if (_draggingSpeed != newSpeed) {
-                _draggingSpeed = newSpeed;
-                [self.dragAnimTimer invalidate];
-                self.dragAnimTimer = [NSTimer timerWithTimeInterval:[self calculateDraggingInterval] target:self selector:@selector(moveEnd) userInfo:nil repeats:YES];
-                [[NSRunLoop mainRunLoop] addTimer:self.dragAnimTimer forMode:NSRunLoopCommonModes];
-                [self.dragAnimTimer fire];
-            }
-        }
-        
-    } else if (distanceToStart < 100) {
-        if (self.pagingEnabled) {
-            [self changePageTimer:NO interval:.5];
-        } else {
-            SMGridViewSortAnimSpeed newSpeed = [self calculateDraggingSpeedWithGap:distanceToStart];
-            if (_draggingSpeed != newSpeed) {
-                _draggingSpeed = newSpeed;
-                [self.dragAnimTimer invalidate];
-                self.dragAnimTimer = [NSTimer timerWithTimeInterval:[self calculateDraggingInterval] target:self selector:@selector(moveStart) userInfo:nil repeats:YES];
-                [[NSRunLoop mainRunLoop] addTimer:self.dragAnimTimer forMode:NSRunLoopCommonModes];
-                [self.dragAnimTimer fire];
-            }
+            [self startDragScroll];
         }
     } else {
-        _draggingSpeed = SMGridViewSortAnimSpeedNone;
-        [self.dragAnimTimer invalidate];
-        self.dragAnimTimer = nil;
+        [self stopDragScroll];
         [self.dragPageAnimTimer invalidate];
         self.dragPageAnimTimer = nil;
     }
 }
 
-- (void)calculatePositionsDrag {
+// Returns YES if the dragged item moved, views are loaded again then
+- (BOOL)calculatePositionsDrag {
     if (_addingOrRemoving) {
-        return;
+        return NO;
     }
     int newPos = [self findDraggingPosition:_draggingView];
-    NSMutableArray *items = [self itemsInSection:_draggingSection];
-    if (newPos != _draggingItemsIndex && newPos >= 0 && newPos < items.count) {
-        SMGridViewItem *item = [[items objectAtIndex:_draggingItemsIndex] retain];
-        [items removeObjectAtIndex:_draggingItemsIndex];
-        [items insertObject:item atIndex:newPos];
-        [item release];
+    SMGridViewSection *sectionItems = [self itemsInSection:_draggingSection];
+    if (newPos != _draggingItemsIndex && newPos >= 0 && newPos < sectionItems.count) {
+        NSInteger oldPos = _draggingItemsIndex;
         _draggingItemsIndex = newPos;
-        [self updateItems];
+        // Usually only the items up to the next checkpoint move, the rest of the section and the ones after stay
+        if ([sectionItems moveItemAndRelayoutAtIndex:oldPos toIndex:newPos params:[self layoutParams]]) {
+            [self invalidateLoadWindow];
+        } else {
+            NSIndexPath *changedIndexPath = [NSIndexPath indexPathForRow:MIN(oldPos, newPos) inSection:_draggingSection];
+            [self updateItemsFromIndexPath:changedIndexPath addIndexPath:nil updateContentSize:YES];
+        }
         [UIView animateWithDuration:0.2 animations:^{
             [self loadViewsForCurrentPos];
         }];
-    } else {
-        // Check if we need to change pages
-        if (self.pagingEnabled) {
-            
-        }
+        return YES;
     }
+    return NO;
 }
 
 - (void)adjustDraggingViewToFit {
@@ -1928,29 +3938,30 @@ typedef NSUInteger SMGridViewSortAnimSpeed;
 
 - (CGPoint)adjustDragPointToFit:(CGPoint)point controlView:(UIControl *)controlView {
     CGRect sectionRect = [self rectForSection:_draggingSection];
-    
-    float minY = CGRectGetMinY(sectionRect) + controlView.frame.size.height/2;
-    float maxY = CGRectGetMaxY(sectionRect) - controlView.frame.size.height/2;
-    float minX = CGRectGetMinX(sectionRect) + controlView.frame.size.width/2;
-    float maxX = CGRectGetMaxX(sectionRect) - controlView.frame.size.width/2;
-    
-    
+
+    CGFloat minY = CGRectGetMinY(sectionRect) + controlView.frame.size.height/2;
+    CGFloat maxY = CGRectGetMaxY(sectionRect) - controlView.frame.size.height/2;
+    CGFloat minX = CGRectGetMinX(sectionRect) + controlView.frame.size.width/2;
+    CGFloat maxX = CGRectGetMaxX(sectionRect) - controlView.frame.size.width/2;
+
+
     if (point.x > maxX) point.x = maxX;
     if (point.x < minX) point.x = minX;
     if (point.y > maxY) point.y = maxY;
     if (point.y < minY) point.y = minY;
-    
+
     return point;
 }
 
-- (void)calculatePositionsDragTimer {
+// Returns YES if the dragged item moved now, NO if it didn't or the move waits for sortWaitBeforeAnimate
+- (BOOL)calculatePositionsDragTimer {
     [self.dragStartAnimTimer invalidate];
     if (_sortWaitBeforeAnimate > 0) {
         self.dragStartAnimTimer = [NSTimer timerWithTimeInterval:_sortWaitBeforeAnimate target:self selector:@selector(calculatePositionsDrag) userInfo:nil repeats:NO];
         [[NSRunLoop mainRunLoop] addTimer:self.dragStartAnimTimer forMode:NSRunLoopCommonModes];
-    } else {
-        [self calculatePositionsDrag];
+        return NO;
     }
+    return [self calculatePositionsDrag];
 }
 
 - (void)dragInside:(UIControl *)controlView withEvent:(UIEvent *)event {
@@ -1960,26 +3971,33 @@ typedef NSUInteger SMGridViewSortAnimSpeed;
     CGPoint point = [[[event allTouches] anyObject] locationInView:self];
     point.x += controlView.frame.size.width/2 - _draggingPoint.x;
     point.y += controlView.frame.size.height/2 - _draggingPoint.y;
-    
+
     [self bringSubviewToFront:controlView];
-    
+
     point = [self adjustDragPointToFit:point controlView:controlView];
     if (!CGPointEqualToPoint(point, controlView.center)) {
         controlView.center = point;
-        [self calculatePositionsDragTimer];
+        if (_dragDisplayLink) {
+            // Evaluated on the next frame, once
+            _dragTargetDirty = YES;
+        } else {
+            [self calculatePositionsDragTimer];
+        }
         [self handleScrollAnimation];
     }
 }
 
 - (void)setEnableSort:(BOOL)enableSort {
-    NSArray *items = [self itemsInSection:_draggingSection];
     if (_enableSort && !enableSort) {
-        if (_draggingView && _draggingOrigItemsIndex < _items.count) {
-            _draggingView.frame = [[items objectAtIndex:_draggingOrigItemsIndex] rect];
+        SMGridViewSection *sectionItems = [self itemsInSection:_draggingSection];
+        if (_draggingView && _draggingOrigItemsIndex >= 0 && _draggingOrigItemsIndex < sectionItems.count) {
+            _draggingView.frame = [sectionItems rectAtIndex:_draggingOrigItemsIndex];
         }
+        [self stopDragScroll];
         self.draggingView = nil;
         _draggingOrigItemsIndex = -1;
         _draggingItemsIndex = -1;
+        [self invalidateLoadWindow];
     }
     _enableSort = enableSort;
 }
@@ -2005,10 +4023,14 @@ typedef NSUInteger SMGridViewSortAnimSpeed;
 
 - (void)scrollViewDidScroll:(UIScrollView *)scrollView {
     if (!_reloadingData) {
-        [CATransaction begin];
-        [CATransaction setDisableActions:YES];
-        [self loadViewsForCurrentPos];
-        [CATransaction commit];
+        [self updateScrollVelocity];
+        // Auto scroll while sorting does its own load pass for the frame
+        if (!_dragScrollingFrame) {
+            [CATransaction begin];
+            [CATransaction setDisableActions:YES];
+            [self loadViewsForCurrentPos];
+            [CATransaction commit];
+        }
     }
     int page = [self findClosestPage:self.contentOffset targetContentOffset:CGPointZero];
     if (page != _currentPage) {
@@ -2018,7 +4040,7 @@ typedef NSUInteger SMGridViewSortAnimSpeed;
 
     [self adjustDraggingViewToOffset];
     _lastOffset = self.contentOffset;
-    
+
     if (self.vertical) {
         if (self.pagingEnabled && [self contentOffsetForPage:_currentPage].y == scrollView.contentOffset.y && (_currentOffsetPage != _currentPage)) {
             _currentOffsetPage = _currentPage;
@@ -2047,13 +4069,16 @@ typedef NSUInteger SMGridViewSortAnimSpeed;
 }
 
 - (void)scrollViewWillEndDragging:(UIScrollView *)scrollView withVelocity:(CGPoint)velocity targetContentOffset:(inout CGPoint *)targetContentOffset {
-    
+
     if ([_gridDelegate respondsToSelector:@selector(scrollViewWillEndDragging:withVelocity:targetContentOffset:)]  && _gridDelegate != (id)self) {
         [_gridDelegate scrollViewWillEndDragging:self withVelocity:velocity targetContentOffset:targetContentOffset];
     }
 }
 
 - (void)scrollViewDidEndDragging:(UIScrollView *)scrollView willDecelerate:(BOOL)decelerate {
+    if (!decelerate) {
+        [self scrollDidStop];
+    }
     if ([_gridDelegate respondsToSelector:@selector(scrollViewDidEndDragging:willDecelerate:)]  && (id)_gridDelegate != self) {
         [_gridDelegate scrollViewDidEndDragging:self willDecelerate:decelerate];
     }
@@ -2066,12 +4091,14 @@ typedef NSUInteger SMGridViewSortAnimSpeed;
 }
 
 - (void)scrollViewDidEndDecelerating:(UIScrollView *)scrollView {
+    [self scrollDidStop];
     if ([_gridDelegate respondsToSelector:@selector(scrollViewDidEndDecelerating:)] && _gridDelegate != (id)self) {
         [_gridDelegate scrollViewDidEndDecelerating:self];
     }
 }
 
 - (void)scrollViewDidEndScrollingAnimation:(UIScrollView *)scrollView {
+    _scrollVelocity = 0;
     if (self.addingIndexPath) {
         [self finishAddingIndexPath:self.addingIndexPath];
         self.addingIndexPath = nil;
@@ -2079,7 +4106,7 @@ typedef NSUInteger SMGridViewSortAnimSpeed;
         [self finishRemovingIndexPath:self.removingIndexPath];
         self.removingIndexPath = nil;
     }
-    
+
     if ([_gridDelegate respondsToSelector:@selector(scrollViewDidEndScrollingAnimation:)]) {
         [_gridDelegate scrollViewDidEndScrollingAnimation:self];
     }
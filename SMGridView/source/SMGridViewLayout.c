@@ -0,0 +1,1235 @@
+//
+//  SMGridViewLayout.c
+//  SMGridView
+//
+
+#include "SMGridViewLayout.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define SMGridViewLayoutMin(a, b) ((a) < (b) ? (a) : (b))
+#define SMGridViewLayoutMax(a, b) ((a) > (b) ? (a) : (b))
+
+static const size_t kSMLayoutDefaultCapacity = 16;
+
+// Used to sort the interval index when min edges are not in item order
+typedef struct {
+    double min;
+    double max;
+    size_t index;
+} SMGridViewLayoutIndexEntry;
+
+static int SMGridViewLayoutIndexEntryCompare(const void *entry1, const void *entry2) {
+    const SMGridViewLayoutIndexEntry *e1 = entry1;
+    const SMGridViewLayoutIndexEntry *e2 = entry2;
+    if (e1->min != e2->min) {
+        return e1->min < e2->min ? -1 : 1;
+    }
+    return e1->index < e2->index ? -1 : (e1->index > e2->index ? 1 : 0);
+}
+
+// Flags of one item of a uniform section, the list is sorted by row
+typedef struct {
+    size_t row;
+    uint8_t flags;
+} SMGridViewLayoutSparseFlag;
+
+/**
+ Rects and flags live in contiguous arrays, 25 bytes per item (24 of rect and 1 of flags, see SMGridViewLayoutRect).
+ The arrays keep free slots before item 0 too, items inserted at the start take them and the others don't move.
+ Main axis coordinates are kept relative to offset, so moving every item only changes offset.
+
+ Items are also indexed along the scroll axis: min edges sorted, plus a running max of the max edges,
+ so the items intersecting [start, end) are found with two binary searches. Layout normally produces
+ min edges in item order, in that case no sort is needed and the index is refreshed from the first changed item.
+ */
+struct SMGridViewLayoutSection {
+    // Item 0 is origin slots after the start of the storage. The index arrays use the same slots
+    SMGridViewLayoutRect *rects;
+    uint8_t *flags;
+    SMGridViewLayoutRect *rectStorage;
+    uint8_t *flagStorage;
+    size_t origin;
+    size_t count;
+    size_t layoutCount;
+    // Slots in the storage, the free ones before item 0 included
+    size_t capacity;
+    // Added to the stored main axis coordinate of every rect, on the axis given by offsetVertical
+    double offset;
+    bool offsetVertical;
+    SMGridViewLayoutRect headerRect;
+    double layoutStart;
+    double *positions;
+    double maxPosition;
+    size_t numberOfRows;
+    double *indexMins;
+    double *indexMaxs;
+    double *indexMinStorage;
+    double *indexMaxStorage;
+    size_t *indexOrder;
+    size_t indexCapacity;
+    size_t indexValidCount;
+    bool indexVertical;
+    // Checkpoints are stored minus offset. Slot n holds the rows before the item stored at n * interval,
+    // slots from checkpointFirst to checkpointCount are valid
+    double *checkpoints;
+    size_t checkpointFirst;
+    size_t checkpointCount;
+    size_t checkpointCapacity;
+    // Rows before item 0, kept apart so it survives inserts at the start
+    double *startCheckpoint;
+    bool hasStartCheckpoint;
+    long itemsPerRow;
+    long itemsPerPage;
+    long firstPage;
+    long pageCount;
+    bool uniform;
+    SMGridViewLayoutSize uniformSize;
+    double uniformStart;
+    SMGridViewLayoutParams uniformParams;
+    SMGridViewLayoutSparseFlag *sparseFlags;
+    size_t sparseCount;
+    size_t sparseCapacity;
+};
+
+SMGridViewLayoutSection *SMGridViewLayoutSectionCreate(void) {
+    return calloc(1, sizeof(SMGridViewLayoutSection));
+}
+
+void SMGridViewLayoutSectionFree(SMGridViewLayoutSection *section) {
+    if (!section) {
+        return;
+    }
+    free(section->rectStorage);
+    free(section->flagStorage);
+    free(section->positions);
+    free(section->indexMinStorage);
+    free(section->indexMaxStorage);
+    free(section->indexOrder);
+    free(section->checkpoints);
+    free(section->startCheckpoint);
+    free(section->sparseFlags);
+    free(section);
+}
+
+
+// Sparse flags
+
+static size_t SMGridViewLayoutSparseFind(const SMGridViewLayoutSection *section, size_t row) {
+    size_t low = 0;
+    size_t high = section->sparseCount;
+    while (low < high) {
+        size_t mid = (low + high) / 2;
+        if (section->sparseFlags[mid].row < row) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+    return low;
+}
+
+static uint8_t SMGridViewLayoutSparseGet(const SMGridViewLayoutSection *section, size_t row) {
+    size_t i = SMGridViewLayoutSparseFind(section, row);
+    return (i < section->sparseCount && section->sparseFlags[i].row == row) ? section->sparseFlags[i].flags : 0;
+}
+
+static void SMGridViewLayoutSparseSet(SMGridViewLayoutSection *section, size_t row, uint8_t flags) {
+    size_t i = SMGridViewLayoutSparseFind(section, row);
+    bool found = i < section->sparseCount && section->sparseFlags[i].row == row;
+    if (found && flags) {
+        section->sparseFlags[i].flags = flags;
+    } else if (found) {
+        memmove(section->sparseFlags + i, section->sparseFlags + i + 1, (section->sparseCount - i - 1) * sizeof(SMGridViewLayoutSparseFlag));
+        section->sparseCount--;
+    } else if (flags) {
+        if (section->sparseCount == section->sparseCapacity) {
+            section->sparseCapacity = SMGridViewLayoutMax(section->sparseCapacity * 2, kSMLayoutDefaultCapacity);
+            section->sparseFlags = realloc(section->sparseFlags, section->sparseCapacity * sizeof(SMGridViewLayoutSparseFlag));
+        }
+        memmove(section->sparseFlags + i + 1, section->sparseFlags + i, (section->sparseCount - i) * sizeof(SMGridViewLayoutSparseFlag));
+        section->sparseFlags[i].row = row;
+        section->sparseFlags[i].flags = flags;
+        section->sparseCount++;
+    }
+}
+
+// Rows from start move by delta. The row they move over must be empty, so the list stays sorted
+static void SMGridViewLayoutSparseShift(SMGridViewLayoutSection *section, size_t start, size_t end, long delta) {
+    for (size_t i = SMGridViewLayoutSparseFind(section, start); i < section->sparseCount && section->sparseFlags[i].row < end; i++) {
+        section->sparseFlags[i].row += delta;
+    }
+}
+
+
+// Items
+
+static void SMGridViewLayoutUpdateItemPointers(SMGridViewLayoutSection *section) {
+    section->rects = section->rectStorage ? section->rectStorage + section->origin : NULL;
+    section->flags = section->flagStorage ? section->flagStorage + section->origin : NULL;
+    section->indexMins = section->indexMinStorage ? section->indexMinStorage + section->origin : NULL;
+    section->indexMaxs = section->indexMaxStorage ? section->indexMaxStorage + section->origin : NULL;
+}
+
+static void SMGridViewLayoutEnsureCapacity(SMGridViewLayoutSection *section, size_t capacity) {
+    capacity += section->origin;
+    if (section->uniform || capacity <= section->capacity) {
+        return;
+    }
+    size_t newCapacity = SMGridViewLayoutMax(SMGridViewLayoutMax(capacity, section->capacity * 2), kSMLayoutDefaultCapacity);
+    section->rectStorage = realloc(section->rectStorage, newCapacity * sizeof(SMGridViewLayoutRect));
+    section->flagStorage = realloc(section->flagStorage, newCapacity * sizeof(uint8_t));
+    section->capacity = newCapacity;
+    SMGridViewLayoutUpdateItemPointers(section);
+}
+
+static void SMGridViewLayoutEnsureCheckpointCapacity(SMGridViewLayoutSection *section, size_t slots) {
+    size_t needed = slots * section->numberOfRows;
+    if (needed > section->checkpointCapacity) {
+        section->checkpointCapacity = SMGridViewLayoutMax(section->checkpointCapacity * 2, needed);
+        section->checkpoints = realloc(section->checkpoints, section->checkpointCapacity * sizeof(double));
+    }
+}
+
+// Makes room for count items before item 0. The storage grows by whole checkpoint intervals,
+// so the checkpoints only move by whole slots
+static void SMGridViewLayoutReserveFront(SMGridViewLayoutSection *section, size_t count) {
+    if (count <= section->origin) {
+        return;
+    }
+    size_t interval = SMGridViewLayoutCheckpointInterval;
+    size_t extra = SMGridViewLayoutMax(SMGridViewLayoutMax(count - section->origin, section->count), kSMLayoutDefaultCapacity);
+    extra = (extra + interval - 1) / interval * interval;
+    size_t newCapacity = section->capacity + extra;
+    section->rectStorage = realloc(section->rectStorage, newCapacity * sizeof(SMGridViewLayoutRect));
+    section->flagStorage = realloc(section->flagStorage, newCapacity * sizeof(uint8_t));
+    memmove(section->rectStorage + section->origin + extra, section->rectStorage + section->origin, section->count * sizeof(SMGridViewLayoutRect));
+    memmove(section->flagStorage + section->origin + extra, section->flagStorage + section->origin, section->count * sizeof(uint8_t));
+    if (section->indexMinStorage) {
+        section->indexMinStorage = realloc(section->indexMinStorage, newCapacity * sizeof(double));
+        section->indexMaxStorage = realloc(section->indexMaxStorage, newCapacity * sizeof(double));
+        memmove(section->indexMinStorage + section->origin + extra, section->indexMinStorage + section->origin, section->indexValidCount * sizeof(double));
+        memmove(section->indexMaxStorage + section->origin + extra, section->indexMaxStorage + section->origin, section->indexValidCount * sizeof(double));
+        section->indexCapacity = newCapacity;
+    }
+    size_t slots = extra / interval;
+    size_t rows = section->numberOfRows;
+    if (section->checkpointCount > section->checkpointFirst) {
+        SMGridViewLayoutEnsureCheckpointCapacity(section, section->checkpointCount + slots);
+        memmove(section->checkpoints + (section->checkpointFirst + slots) * rows, section->checkpoints + section->checkpointFirst * rows, (section->checkpointCount - section->checkpointFirst) * rows * sizeof(double));
+    }
+    section->checkpointFirst += slots;
+    section->checkpointCount += slots;
+    section->origin += extra;
+    section->capacity = newCapacity;
+    SMGridViewLayoutUpdateItemPointers(section);
+}
+
+static void SMGridViewLayoutInvalidateFromIndex(SMGridViewLayoutSection *section, size_t index) {
+    section->indexValidCount = SMGridViewLayoutMin(section->indexValidCount, index);
+    // Slots up to the one of index hold the rows from before it
+    size_t end = (section->origin + index) / SMGridViewLayoutCheckpointInterval + 1;
+    section->checkpointCount = SMGridViewLayoutMax(SMGridViewLayoutMin(section->checkpointCount, end), section->checkpointFirst);
+}
+
+static void SMGridViewLayoutAddToMain(SMGridViewLayoutRect *rect, bool vertical, double delta) {
+    if (vertical) {
+        rect->y += delta;
+    } else {
+        rect->x += delta;
+    }
+}
+
+size_t SMGridViewLayoutSectionGetCount(const SMGridViewLayoutSection *section) {
+    return section->count;
+}
+
+void SMGridViewLayoutSectionSetCount(SMGridViewLayoutSection *section, size_t count) {
+    SMGridViewLayoutInvalidateFromIndex(section, count);
+    if (section->uniform) {
+        section->sparseCount = SMGridViewLayoutSparseFind(section, count);
+        section->count = count;
+        section->layoutCount = count;
+        return;
+    }
+    if (count > section->count) {
+        SMGridViewLayoutEnsureCapacity(section, count);
+        memset(section->rects + section->count, 0, (count - section->count) * sizeof(SMGridViewLayoutRect));
+        memset(section->flags + section->count, 0, (count - section->count) * sizeof(uint8_t));
+    }
+    section->count = count;
+    section->layoutCount = SMGridViewLayoutMin(section->layoutCount, count);
+}
+
+size_t SMGridViewLayoutSectionGetLayoutCount(const SMGridViewLayoutSection *section) {
+    return section->layoutCount;
+}
+
+void SMGridViewLayoutSectionSetLayoutCount(SMGridViewLayoutSection *section, size_t layoutCount) {
+    layoutCount = section->uniform ? section->count : SMGridViewLayoutMin(layoutCount, section->count);
+    if (layoutCount < section->layoutCount) {
+        SMGridViewLayoutInvalidateFromIndex(section, layoutCount);
+    }
+    section->layoutCount = layoutCount;
+}
+
+void SMGridViewLayoutSectionInsertItems(SMGridViewLayoutSection *section, size_t index, size_t count) {
+    index = SMGridViewLayoutMin(index, section->count);
+    if (count == 0) {
+        return;
+    }
+    if (section->uniform) {
+        SMGridViewLayoutSparseShift(section, index, section->count, (long)count);
+    } else if (index == 0) {
+        // Into the free slots before item 0, nothing moves
+        SMGridViewLayoutReserveFront(section, count);
+        section->origin -= count;
+        SMGridViewLayoutUpdateItemPointers(section);
+        memset(section->rects, 0, count * sizeof(SMGridViewLayoutRect));
+        memset(section->flags, 0, count * sizeof(uint8_t));
+    } else {
+        SMGridViewLayoutEnsureCapacity(section, section->count + count);
+        memmove(section->rects + index + count, section->rects + index, (section->count - index) * sizeof(SMGridViewLayoutRect));
+        memmove(section->flags + index + count, section->flags + index, (section->count - index) * sizeof(uint8_t));
+        memset(section->rects + index, 0, count * sizeof(SMGridViewLayoutRect));
+        memset(section->flags + index, 0, count * sizeof(uint8_t));
+    }
+    section->count += count;
+    if (section->uniform || index < section->layoutCount) {
+        section->layoutCount += count;
+    }
+    SMGridViewLayoutInvalidateFromIndex(section, index);
+}
+
+void SMGridViewLayoutSectionInsertItem(SMGridViewLayoutSection *section, size_t index) {
+    SMGridViewLayoutSectionInsertItems(section, index, 1);
+}
+
+void SMGridViewLayoutSectionRemoveItem(SMGridViewLayoutSection *section, size_t index) {
+    if (index >= section->count) {
+        return;
+    }
+    if (section->uniform) {
+        SMGridViewLayoutSparseSet(section, index, 0);
+        SMGridViewLayoutSparseShift(section, index + 1, section->count, -1);
+    } else {
+        memmove(section->rects + index, section->rects + index + 1, (section->count - index - 1) * sizeof(SMGridViewLayoutRect));
+        memmove(section->flags + index, section->flags + index + 1, (section->count - index - 1) * sizeof(uint8_t));
+    }
+    section->count--;
+    if (index < section->layoutCount) {
+        section->layoutCount--;
+    }
+    SMGridViewLayoutInvalidateFromIndex(section, index);
+}
+
+void SMGridViewLayoutSectionMoveItem(SMGridViewLayoutSection *section, size_t fromIndex, size_t toIndex) {
+    if (fromIndex == toIndex || fromIndex >= section->count || toIndex >= section->count) {
+        return;
+    }
+    if (section->uniform) {
+        uint8_t flags = SMGridViewLayoutSparseGet(section, fromIndex);
+        SMGridViewLayoutSparseSet(section, fromIndex, 0);
+        if (fromIndex < toIndex) {
+            SMGridViewLayoutSparseShift(section, fromIndex + 1, toIndex + 1, -1);
+        } else {
+            // From the end, so rows don't pass over each other
+            for (size_t i = SMGridViewLayoutSparseFind(section, fromIndex); i > 0 && section->sparseFlags[i-1].row >= toIndex; i--) {
+                section->sparseFlags[i-1].row++;
+            }
+        }
+        SMGridViewLayoutSparseSet(section, toIndex, flags);
+    } else {
+        SMGridViewLayoutRect rect = section->rects[fromIndex];
+        uint8_t flags = section->flags[fromIndex];
+        if (fromIndex < toIndex) {
+            memmove(section->rects + fromIndex, section->rects + fromIndex + 1, (toIndex - fromIndex) * sizeof(SMGridViewLayoutRect));
+            memmove(section->flags + fromIndex, section->flags + fromIndex + 1, (toIndex - fromIndex) * sizeof(uint8_t));
+        } else {
+            memmove(section->rects + toIndex + 1, section->rects + toIndex, (fromIndex - toIndex) * sizeof(SMGridViewLayoutRect));
+            memmove(section->flags + toIndex + 1, section->flags + toIndex, (fromIndex - toIndex) * sizeof(uint8_t));
+        }
+        section->rects[toIndex] = rect;
+        section->flags[toIndex] = flags;
+    }
+    SMGridViewLayoutInvalidateFromIndex(section, SMGridViewLayoutMin(fromIndex, toIndex));
+}
+
+static SMGridViewLayoutRect SMGridViewLayoutUniformRect(const SMGridViewLayoutSection *section, size_t index);
+
+SMGridViewLayoutRect SMGridViewLayoutSectionGetRect(const SMGridViewLayoutSection *section, size_t index) {
+    if (section->uniform) {
+        return SMGridViewLayoutUniformRect(section, index);
+    }
+    SMGridViewLayoutRect rect = section->rects[index];
+    SMGridViewLayoutAddToMain(&rect, section->offsetVertical, section->offset);
+    return rect;
+}
+
+void SMGridViewLayoutSectionSetRect(SMGridViewLayoutSection *section, size_t index, SMGridViewLayoutRect rect) {
+    if (section->uniform) {
+        // Rects are computed
+        return;
+    }
+    SMGridViewLayoutAddToMain(&rect, section->offsetVertical, -section->offset);
+    if (memcmp(&rect, section->rects + index, sizeof(SMGridViewLayoutRect)) != 0) {
+        section->rects[index] = rect;
+        SMGridViewLayoutInvalidateFromIndex(section, index);
+    }
+}
+
+uint8_t SMGridViewLayoutSectionGetFlags(const SMGridViewLayoutSection *section, size_t index) {
+    if (section->uniform) {
+        return SMGridViewLayoutSparseGet(section, index);
+    }
+    return section->flags[index];
+}
+
+void SMGridViewLayoutSectionSetFlags(SMGridViewLayoutSection *section, size_t index, uint8_t flags) {
+    if (section->uniform) {
+        SMGridViewLayoutSparseSet(section, index, flags);
+    } else {
+        section->flags[index] = flags;
+    }
+}
+
+SMGridViewLayoutRect SMGridViewLayoutSectionGetHeaderRect(const SMGridViewLayoutSection *section) {
+    return section->headerRect;
+}
+
+void SMGridViewLayoutSectionSetHeaderRect(SMGridViewLayoutSection *section, SMGridViewLayoutRect rect) {
+    section->headerRect = rect;
+}
+
+
+// Interval index
+
+static void SMGridViewLayoutEnsureIndexCapacity(SMGridViewLayoutSection *section) {
+    if (section->indexCapacity < section->capacity) {
+        section->indexMinStorage = realloc(section->indexMinStorage, section->capacity * sizeof(double));
+        section->indexMaxStorage = realloc(section->indexMaxStorage, section->capacity * sizeof(double));
+        section->indexCapacity = section->capacity;
+        SMGridViewLayoutUpdateItemPointers(section);
+    }
+}
+
+static void SMGridViewLayoutBuildSortedIndex(SMGridViewLayoutSection *section) {
+    size_t layoutCount = section->layoutCount;
+    SMGridViewLayoutIndexEntry *entries = malloc(SMGridViewLayoutMax(layoutCount, 1) * sizeof(SMGridViewLayoutIndexEntry));
+    for (size_t i = 0; i < layoutCount; i++) {
+        SMGridViewLayoutRect rect = section->rects[i];
+        entries[i].min = section->indexVertical ? rect.y : rect.x;
+        entries[i].max = entries[i].min + (section->indexVertical ? rect.height : rect.width);
+        entries[i].index = i;
+    }
+    qsort(entries, layoutCount, sizeof(SMGridViewLayoutIndexEntry), SMGridViewLayoutIndexEntryCompare);
+    section->indexOrder = realloc(section->indexOrder, SMGridViewLayoutMax(section->indexCapacity, 1) * sizeof(size_t));
+    for (size_t i = 0; i < layoutCount; i++) {
+        section->indexMins[i] = entries[i].min;
+        section->indexMaxs[i] = i > 0 ? SMGridViewLayoutMax(section->indexMaxs[i-1], entries[i].max) : entries[i].max;
+        section->indexOrder[i] = entries[i].index;
+    }
+    free(entries);
+    section->indexValidCount = layoutCount;
+}
+
+static void SMGridViewLayoutBuildIndex(SMGridViewLayoutSection *section, bool vertical) {
+    if (vertical != section->indexVertical) {
+        section->indexVertical = vertical;
+        section->indexValidCount = 0;
+    }
+    if (section->indexOrder && section->indexValidCount != section->layoutCount) {
+        // A sorted index can't be patched in place
+        section->indexValidCount = 0;
+    }
+    if (section->indexValidCount == section->layoutCount) {
+        return;
+    }
+    if (section->indexValidCount == 0) {
+        free(section->indexOrder);
+        section->indexOrder = NULL;
+    }
+    SMGridViewLayoutEnsureIndexCapacity(section);
+    for (size_t i = section->indexValidCount; i < section->layoutCount; i++) {
+        SMGridViewLayoutRect rect = section->rects[i];
+        double min = vertical ? rect.y : rect.x;
+        double max = min + (vertical ? rect.height : rect.width);
+        if (i > 0 && min < section->indexMins[i-1]) {
+            SMGridViewLayoutBuildSortedIndex(section);
+            return;
+        }
+        section->indexMins[i] = min;
+        section->indexMaxs[i] = i > 0 ? SMGridViewLayoutMax(section->indexMaxs[i-1], max) : max;
+    }
+    section->indexValidCount = section->layoutCount;
+}
+
+static void SMGridViewLayoutEnumerateUniformItems(const SMGridViewLayoutSection *section, double start, double end, SMGridViewLayoutItemCallback callback, void *context);
+
+void SMGridViewLayoutSectionEnumerateItems(SMGridViewLayoutSection *section, double start, double end, bool vertical, SMGridViewLayoutItemCallback callback, void *context) {
+    if (section->uniform) {
+        SMGridViewLayoutEnumerateUniformItems(section, start, end, callback, context);
+        return;
+    }
+    SMGridViewLayoutBuildIndex(section, vertical);
+    // The index has the stored coordinates
+    if (vertical == section->offsetVertical) {
+        start -= section->offset;
+        end -= section->offset;
+    }
+    // Items starting before end
+    size_t low = 0;
+    size_t high = section->layoutCount;
+    while (low < high) {
+        size_t mid = (low + high) / 2;
+        if (section->indexMins[mid] < end) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+    size_t last = low;
+    // Skip the ones where every item so far ends before start
+    low = 0;
+    high = last;
+    while (low < high) {
+        size_t mid = (low + high) / 2;
+        if (section->indexMaxs[mid] > start) {
+            high = mid;
+        } else {
+            low = mid + 1;
+        }
+    }
+    bool stop = false;
+    for (size_t i = low; i < last && !stop; i++) {
+        size_t index = section->indexOrder ? section->indexOrder[i] : i;
+        SMGridViewLayoutRect rect = section->rects[index];
+        double max = vertical ? rect.y + rect.height : rect.x + rect.width;
+        if (max > start) {
+            callback(index, context, &stop);
+        }
+    }
+}
+
+
+// Row positions
+
+double *SMGridViewLayoutSectionGetPositions(const SMGridViewLayoutSection *section) {
+    return section->positions;
+}
+
+size_t SMGridViewLayoutSectionGetNumberOfRows(const SMGridViewLayoutSection *section) {
+    return section->numberOfRows;
+}
+
+double SMGridViewLayoutSectionGetMaxPosition(const SMGridViewLayoutSection *section) {
+    return section->maxPosition;
+}
+
+double SMGridViewLayoutSectionGetLayoutStart(const SMGridViewLayoutSection *section) {
+    return section->layoutStart;
+}
+
+void SMGridViewLayoutSectionSetLayoutStart(SMGridViewLayoutSection *section, double layoutStart) {
+    section->layoutStart = layoutStart;
+}
+
+static void SMGridViewLayoutClearCheckpoints(SMGridViewLayoutSection *section) {
+    section->checkpointFirst = 0;
+    section->checkpointCount = 0;
+    section->hasStartCheckpoint = false;
+}
+
+void SMGridViewLayoutSectionResetPositions(SMGridViewLayoutSection *section, size_t rows, double value) {
+    SMGridViewLayoutClearCheckpoints(section);
+    if (rows != section->numberOfRows) {
+        section->positions = realloc(section->positions, SMGridViewLayoutMax(rows, 1) * sizeof(double));
+        section->startCheckpoint = realloc(section->startCheckpoint, SMGridViewLayoutMax(rows, 1) * sizeof(double));
+        section->numberOfRows = rows;
+    }
+    for (size_t i = 0; i < rows; i++) {
+        section->positions[i] = value;
+    }
+    section->maxPosition = rows > 0 ? value : 0;
+}
+
+static void SMGridViewLayoutUpdateMaxPosition(SMGridViewLayoutSection *section) {
+    section->maxPosition = 0;
+    for (size_t i = 0; i < section->numberOfRows; i++) {
+        section->maxPosition = i > 0 ? SMGridViewLayoutMax(section->maxPosition, section->positions[i]) : section->positions[i];
+    }
+}
+
+void SMGridViewLayoutSectionSetPosition(SMGridViewLayoutSection *section, size_t row, double value) {
+    double oldValue = section->positions[row];
+    section->positions[row] = value;
+    if (value >= section->maxPosition) {
+        section->maxPosition = value;
+    } else if (oldValue == section->maxPosition) {
+        SMGridViewLayoutUpdateMaxPosition(section);
+    }
+}
+
+void SMGridViewLayoutSectionExtendPositions(SMGridViewLayoutSection *section, size_t rows, double value) {
+    if (rows <= section->numberOfRows) {
+        return;
+    }
+    section->positions = realloc(section->positions, rows * sizeof(double));
+    section->startCheckpoint = realloc(section->startCheckpoint, rows * sizeof(double));
+    for (size_t i = section->numberOfRows; i < rows; i++) {
+        section->positions[i] = value;
+    }
+    section->maxPosition = section->numberOfRows > 0 ? SMGridViewLayoutMax(section->maxPosition, value) : value;
+    section->numberOfRows = rows;
+    SMGridViewLayoutClearCheckpoints(section);
+}
+
+static void SMGridViewLayoutStoreCheckpoint(SMGridViewLayoutSection *section, double *checkpoint) {
+    for (size_t i = 0; i < section->numberOfRows; i++) {
+        checkpoint[i] = section->positions[i] - section->offset;
+    }
+}
+
+static void SMGridViewLayoutLoadCheckpoint(SMGridViewLayoutSection *section, const double *checkpoint) {
+    for (size_t i = 0; i < section->numberOfRows; i++) {
+        section->positions[i] = checkpoint[i] + section->offset;
+    }
+    SMGridViewLayoutUpdateMaxPosition(section);
+}
+
+void SMGridViewLayoutSectionSaveCheckpoint(SMGridViewLayoutSection *section, size_t index) {
+    if (index == 0 && section->startCheckpoint) {
+        SMGridViewLayoutStoreCheckpoint(section, section->startCheckpoint);
+        section->hasStartCheckpoint = true;
+    }
+    if ((section->origin + index) % SMGridViewLayoutCheckpointInterval != 0) {
+        return;
+    }
+    size_t checkpoint = (section->origin + index) / SMGridViewLayoutCheckpointInterval;
+    if (checkpoint < section->checkpointFirst || checkpoint > section->checkpointCount) {
+        // Layout didn't go through the ones between, they are dropped
+        section->checkpointFirst = checkpoint;
+    }
+    SMGridViewLayoutEnsureCheckpointCapacity(section, checkpoint + 1);
+    SMGridViewLayoutStoreCheckpoint(section, section->checkpoints + checkpoint * section->numberOfRows);
+    section->checkpointCount = checkpoint + 1;
+}
+
+// Item of the closest checkpoint before index, the start one counts as item 0. SMGridViewLayoutNotFound if none
+static size_t SMGridViewLayoutCheckpointItem(const SMGridViewLayoutSection *section, size_t index) {
+    size_t interval = SMGridViewLayoutCheckpointInterval;
+    if (section->checkpointCount > section->checkpointFirst) {
+        size_t checkpoint = SMGridViewLayoutMin((section->origin + index) / interval, section->checkpointCount - 1);
+        if (checkpoint >= section->checkpointFirst) {
+            return checkpoint * interval - section->origin;
+        }
+    }
+    return section->hasStartCheckpoint ? 0 : SMGridViewLayoutNotFound;
+}
+
+size_t SMGridViewLayoutSectionRestoreCheckpoint(SMGridViewLayoutSection *section, size_t index) {
+    size_t item = SMGridViewLayoutCheckpointItem(section, index);
+    if (item == SMGridViewLayoutNotFound) {
+        return item;
+    }
+    size_t checkpoint = (section->origin + item) / SMGridViewLayoutCheckpointInterval;
+    if ((section->origin + item) % SMGridViewLayoutCheckpointInterval == 0 && checkpoint >= section->checkpointFirst && checkpoint < section->checkpointCount) {
+        SMGridViewLayoutLoadCheckpoint(section, section->checkpoints + checkpoint * section->numberOfRows);
+    } else {
+        SMGridViewLayoutLoadCheckpoint(section, section->startCheckpoint);
+    }
+    return item;
+}
+
+// Puts the offset on the given axis. Changing axis moves it into the stored rects, that only happens
+// when the grid changes direction
+static void SMGridViewLayoutUseOffsetAxis(SMGridViewLayoutSection *section, bool vertical) {
+    if (vertical == section->offsetVertical) {
+        return;
+    }
+    if (section->offset != 0) {
+        for (size_t i = 0; !section->uniform && i < section->count; i++) {
+            SMGridViewLayoutAddToMain(section->rects + i, section->offsetVertical, section->offset);
+        }
+        for (size_t i = section->checkpointFirst * section->numberOfRows; i < section->checkpointCount * section->numberOfRows; i++) {
+            section->checkpoints[i] += section->offset;
+        }
+        for (size_t i = 0; section->hasStartCheckpoint && i < section->numberOfRows; i++) {
+            section->startCheckpoint[i] += section->offset;
+        }
+        if (section->indexVertical == section->offsetVertical) {
+            section->indexValidCount = 0;
+        }
+        section->offset = 0;
+    }
+    section->offsetVertical = vertical;
+}
+
+// Adds delta to the checkpoints of slots [first, end), only the valid ones
+static void SMGridViewLayoutShiftCheckpoints(SMGridViewLayoutSection *section, size_t first, size_t end, double delta) {
+    first = SMGridViewLayoutMax(first, section->checkpointFirst);
+    end = SMGridViewLayoutMin(end, section->checkpointCount);
+    for (size_t i = first * section->numberOfRows; i < end * section->numberOfRows; i++) {
+        section->checkpoints[i] += delta;
+    }
+}
+
+void SMGridViewLayoutSectionShift(SMGridViewLayoutSection *section, double delta, bool vertical) {
+    if (section->uniform) {
+        section->uniformStart += delta;
+    } else {
+        // Rects, the index and the checkpoints are relative to the offset, they move with it
+        SMGridViewLayoutUseOffsetAxis(section, vertical);
+        section->offset += delta;
+    }
+    SMGridViewLayoutAddToMain(&section->headerRect, vertical, delta);
+    for (size_t i = 0; i < section->numberOfRows; i++) {
+        section->positions[i] += delta;
+    }
+    section->maxPosition += delta;
+    section->layoutStart += delta;
+}
+
+static bool SMGridViewLayoutPatchIndex(SMGridViewLayoutSection *section, size_t start, size_t end, size_t validCount);
+
+void SMGridViewLayoutSectionShiftItems(SMGridViewLayoutSection *section, size_t index, double delta, bool vertical) {
+    if (section->uniform || delta == 0) {
+        return;
+    }
+    SMGridViewLayoutUseOffsetAxis(section, vertical);
+    // Checkpoints up to the one of index hold rows from before it, the ones after moved with the items
+    size_t split = (section->origin + index) / SMGridViewLayoutCheckpointInterval + 1;
+    bool indexed = section->indexVertical == vertical;
+    if (index < section->layoutCount && index < section->layoutCount - index) {
+        // Fewer items before index: everything moves with the offset and those go back
+        section->offset += delta;
+        for (size_t i = 0; i < index; i++) {
+            SMGridViewLayoutAddToMain(section->rects + i, vertical, -delta);
+        }
+        SMGridViewLayoutShiftCheckpoints(section, 0, split, -delta);
+        for (size_t i = 0; section->hasStartCheckpoint && i < section->numberOfRows; i++) {
+            section->startCheckpoint[i] -= delta;
+        }
+        size_t validCount = section->indexOrder ? 0 : section->indexValidCount;
+        if (indexed && !SMGridViewLayoutPatchIndex(section, 0, SMGridViewLayoutMin(index, validCount), validCount)) {
+            section->indexValidCount = 0;
+        }
+    } else {
+        for (size_t i = index; i < section->layoutCount; i++) {
+            SMGridViewLayoutAddToMain(section->rects + i, vertical, delta);
+        }
+        SMGridViewLayoutShiftCheckpoints(section, split, section->checkpointCount, delta);
+        if (indexed) {
+            section->indexValidCount = SMGridViewLayoutMin(section->indexValidCount, index);
+        }
+    }
+}
+
+// Placement
+
+size_t SMGridViewLayoutSectionRowForItem(const SMGridViewLayoutSection *section, size_t index, SMGridViewLayoutParams params) {
+    if (params.pageSize > 0 && params.inverseOrder) {
+        return SMGridViewLayoutSectionPagingRowForItem(section, index);
+    }
+    if (section->numberOfRows == 0) {
+        return 0;
+    }
+    // Seeded with the first row, a fixed bound would send everything to row 0 once all rows pass it
+    double minValue = section->positions[0];
+    size_t ret = 0;
+    for (size_t i = 1; i < section->numberOfRows; i++) {
+        if (section->positions[i] < minValue) {
+            minValue = section->positions[i];
+            ret = i;
+        }
+    }
+    return ret;
+}
+
+// The first items of a page go to the start of the page. Page 0 starts where the rows are, after the header
+SMGridViewLayoutRect SMGridViewLayoutSectionRectForItem(const SMGridViewLayoutSection *section, size_t index, size_t row, SMGridViewLayoutSize size, SMGridViewLayoutParams params) {
+    double main = section->positions[row];
+    if (params.pageSize > 0 && SMGridViewLayoutSectionIsFirstOfPage(section, index, params.inverseOrder)) {
+        long page = SMGridViewLayoutSectionPageForItem(section, index);
+        if (page != 0) {
+            main = page * params.pageSize + params.padding;
+        }
+    }
+    SMGridViewLayoutRect rect = {0, 0, size.width, size.height};
+    if (params.vertical) {
+        rect.x = row * (size.width + params.padding) + params.padding;
+        rect.y = main;
+    } else {
+        rect.x = main;
+        rect.y = row * (size.height + params.padding) + params.padding;
+    }
+    return rect;
+}
+
+void SMGridViewLayoutSectionAdvanceRow(SMGridViewLayoutSection *section, size_t row, SMGridViewLayoutRect rect, SMGridViewLayoutParams params) {
+    double value = params.vertical ? rect.y + rect.height : rect.x + rect.width;
+    SMGridViewLayoutSectionSetPosition(section, row, value + params.padding);
+}
+
+// Keeps the rect of a relayout without invalidating anything, the caller checks what changed
+static void SMGridViewLayoutAdvanceRowAndStore(SMGridViewLayoutSection *section, size_t index, size_t row, SMGridViewLayoutRect rect, SMGridViewLayoutParams params) {
+    SMGridViewLayoutSectionAdvanceRow(section, row, rect, params);
+    SMGridViewLayoutAddToMain(&rect, section->offsetVertical, -section->offset);
+    section->rects[index] = rect;
+}
+
+static double SMGridViewLayoutRectMin(SMGridViewLayoutRect rect, bool vertical) {
+    return vertical ? rect.y : rect.x;
+}
+
+static double SMGridViewLayoutRectMax(SMGridViewLayoutRect rect, bool vertical) {
+    return vertical ? rect.y + rect.height : rect.x + rect.width;
+}
+
+// Refreshes the index entries of [start, end) and the running max after them until it matches the old one.
+// Items from end on must have kept their rects. Returns false if min edges are not in order anymore
+static bool SMGridViewLayoutPatchIndex(SMGridViewLayoutSection *section, size_t start, size_t end, size_t validCount) {
+    bool vertical = section->indexVertical;
+    for (size_t i = start; i < end; i++) {
+        double min = SMGridViewLayoutRectMin(section->rects[i], vertical);
+        double max = SMGridViewLayoutRectMax(section->rects[i], vertical);
+        if (i > 0 && min < section->indexMins[i-1]) {
+            return false;
+        }
+        section->indexMins[i] = min;
+        section->indexMaxs[i] = i > 0 ? SMGridViewLayoutMax(section->indexMaxs[i-1], max) : max;
+    }
+    if (end < validCount && end > 0 && section->indexMins[end] < section->indexMins[end-1]) {
+        return false;
+    }
+    for (size_t i = end; i < validCount && i > 0; i++) {
+        double max = SMGridViewLayoutMax(section->indexMaxs[i-1], SMGridViewLayoutRectMax(section->rects[i], vertical));
+        if (max == section->indexMaxs[i]) {
+            break;
+        }
+        section->indexMaxs[i] = max;
+    }
+    section->indexValidCount = validCount;
+    return true;
+}
+
+bool SMGridViewLayoutSectionMoveItemAndRelayout(SMGridViewLayoutSection *section, size_t fromIndex, size_t toIndex, SMGridViewLayoutParams params) {
+    if (section->uniform) {
+        // Rects don't depend on the order
+        SMGridViewLayoutSectionMoveItem(section, fromIndex, toIndex);
+        return true;
+    }
+    size_t interval = SMGridViewLayoutCheckpointInterval;
+    size_t low = SMGridViewLayoutMin(fromIndex, toIndex);
+    size_t high = SMGridViewLayoutMax(fromIndex, toIndex) + 1;
+    size_t layoutCount = section->layoutCount;
+    size_t checkpointFirst = section->checkpointFirst;
+    size_t checkpointCount = section->checkpointCount;
+    size_t rows = section->numberOfRows;
+    if (high > layoutCount || SMGridViewLayoutCheckpointItem(section, low) == SMGridViewLayoutNotFound || rows == 0) {
+        SMGridViewLayoutSectionMoveItem(section, fromIndex, toIndex);
+        return false;
+    }
+    // Layout stops at the first checkpoint after the moved items, the rows there have to be the same as before
+    size_t checkpoint = (section->origin + high + interval - 1) / interval;
+    size_t end = checkpoint * interval - section->origin;
+    double *expected = malloc(2 * rows * sizeof(double));
+    double *finalPositions = expected + rows;
+    memcpy(finalPositions, section->positions, rows * sizeof(double));
+    if (end < layoutCount && checkpoint >= checkpointFirst && checkpoint < checkpointCount) {
+        for (size_t row = 0; row < rows; row++) {
+            expected[row] = section->checkpoints[checkpoint * rows + row] + section->offset;
+        }
+    } else {
+        end = layoutCount;
+        memcpy(expected, finalPositions, rows * sizeof(double));
+    }
+    size_t validCount = section->indexOrder ? 0 : section->indexValidCount;
+
+    SMGridViewLayoutSectionMoveItem(section, fromIndex, toIndex);
+    size_t start = SMGridViewLayoutSectionRestoreCheckpoint(section, low);
+    for (size_t i = start; i < end; i++) {
+        SMGridViewLayoutSectionSaveCheckpoint(section, i);
+        size_t row = SMGridViewLayoutSectionRowForItem(section, i, params);
+        SMGridViewLayoutSize size = {section->rects[i].width, section->rects[i].height};
+        SMGridViewLayoutRect rect = SMGridViewLayoutSectionRectForItem(section, i, row, size, params);
+        SMGridViewLayoutAdvanceRowAndStore(section, i, row, rect, params);
+    }
+    bool same = memcmp(expected, section->positions, rows * sizeof(double)) == 0;
+    if (same) {
+        // Everything after end is laid out as it was, checkpoints included
+        memcpy(section->positions, finalPositions, rows * sizeof(double));
+        SMGridViewLayoutUpdateMaxPosition(section);
+        if (section->checkpointCount >= checkpointFirst && section->checkpointFirst <= checkpointCount) {
+            section->checkpointFirst = SMGridViewLayoutMin(section->checkpointFirst, checkpointFirst);
+            section->checkpointCount = SMGridViewLayoutMax(section->checkpointCount, checkpointCount);
+        }
+        if (validCount < end || !SMGridViewLayoutPatchIndex(section, start, end, validCount)) {
+            section->indexValidCount = SMGridViewLayoutMin(section->indexValidCount, start);
+        }
+    }
+    free(expected);
+    return same;
+}
+
+bool SMGridViewLayoutSectionPrependItems(SMGridViewLayoutSection *section, const SMGridViewLayoutSize *sizes, size_t count, uint8_t flags, SMGridViewLayoutParams params) {
+    size_t rows = section->numberOfRows;
+    if (section->uniform || params.pageSize > 0 || rows == 0 || !section->hasStartCheckpoint) {
+        SMGridViewLayoutSectionInsertItems(section, 0, count);
+        for (size_t i = 0; i < count; i++) {
+            SMGridViewLayoutRect rect = {0, 0, sizes[i].width, sizes[i].height};
+            SMGridViewLayoutSectionSetRect(section, i, rect);
+            SMGridViewLayoutSectionSetFlags(section, i, flags);
+        }
+        return false;
+    }
+    if (count == 0) {
+        return true;
+    }
+    size_t interval = SMGridViewLayoutCheckpointInterval;
+    SMGridViewLayoutUseOffsetAxis(section, params.vertical);
+    SMGridViewLayoutReserveFront(section, count);
+    size_t validCount = section->indexOrder ? 0 : section->indexValidCount;
+    size_t oldFirst = section->checkpointFirst;
+    size_t oldEnd = section->checkpointCount;
+    double *oldPositions = malloc(2 * rows * sizeof(double));
+    double *startPositions = oldPositions + rows;
+    memcpy(oldPositions, section->positions, rows * sizeof(double));
+
+    // The new items take free slots before item 0. The others keep their storage, index entries and checkpoints
+    section->origin -= count;
+    SMGridViewLayoutUpdateItemPointers(section);
+    section->count += count;
+    section->layoutCount += count;
+    SMGridViewLayoutLoadCheckpoint(section, section->startCheckpoint);
+    memcpy(startPositions, section->positions, rows * sizeof(double));
+    // Slots of the new items, they come right before the old ones
+    size_t first = (section->origin + interval - 1) / interval;
+    size_t end = (section->origin + count + interval - 1) / interval;
+    SMGridViewLayoutEnsureCheckpointCapacity(section, end);
+    for (size_t i = 0; i < count; i++) {
+        if ((section->origin + i) % interval == 0) {
+            SMGridViewLayoutStoreCheckpoint(section, section->checkpoints + (section->origin + i) / interval * rows);
+        }
+        size_t row = SMGridViewLayoutSectionRowForItem(section, i, params);
+        SMGridViewLayoutRect rect = SMGridViewLayoutSectionRectForItem(section, i, row, sizes[i], params);
+        SMGridViewLayoutAdvanceRowAndStore(section, i, row, rect, params);
+        section->flags[i] = flags;
+    }
+    double delta = section->positions[0] - startPositions[0];
+    bool sameDelta = true;
+    for (size_t row = 1; row < rows && sameDelta; row++) {
+        sameDelta = section->positions[row] - startPositions[row] == delta;
+    }
+    if (!sameDelta) {
+        // Only the new items are laid out, the checkpoints of the others are wrong now
+        section->checkpointFirst = first;
+        section->checkpointCount = end;
+        section->layoutCount = count;
+        section->indexValidCount = 0;
+        free(oldPositions);
+        return false;
+    }
+
+    // The old items move by delta through the offset, the new ones and the checkpoints before them stay
+    section->offset += delta;
+    for (size_t i = 0; i < count; i++) {
+        SMGridViewLayoutAddToMain(section->rects + i, params.vertical, -delta);
+    }
+    for (size_t i = first * rows; i < end * rows; i++) {
+        section->checkpoints[i] -= delta;
+    }
+    for (size_t row = 0; row < rows; row++) {
+        section->startCheckpoint[row] -= delta;
+    }
+    if (oldFirst == oldEnd) {
+        section->checkpointFirst = first;
+        section->checkpointCount = end;
+    } else if (end == oldFirst) {
+        section->checkpointFirst = first;
+        section->checkpointCount = oldEnd;
+    } else {
+        section->checkpointFirst = oldFirst;
+        section->checkpointCount = oldEnd;
+    }
+    if (validCount == 0 || !SMGridViewLayoutPatchIndex(section, 0, count, count + validCount)) {
+        section->indexValidCount = 0;
+    }
+    for (size_t row = 0; row < rows; row++) {
+        section->positions[row] = oldPositions[row] + delta;
+    }
+    SMGridViewLayoutUpdateMaxPosition(section);
+    free(oldPositions);
+    return true;
+}
+
+// Paging
+
+void SMGridViewLayoutSectionSetPaging(SMGridViewLayoutSection *section, long itemsPerRow, long itemsPerPage, long firstPage) {
+    section->itemsPerRow = itemsPerRow;
+    section->itemsPerPage = itemsPerPage;
+    section->firstPage = firstPage;
+    section->pageCount = itemsPerPage > 0 ? ((long)section->count + itemsPerPage - 1) / itemsPerPage : 0;
+}
+
+long SMGridViewLayoutSectionGetItemsPerRow(const SMGridViewLayoutSection *section) {
+    return section->itemsPerRow;
+}
+
+long SMGridViewLayoutSectionGetItemsPerPage(const SMGridViewLayoutSection *section) {
+    return section->itemsPerPage;
+}
+
+long SMGridViewLayoutSectionGetFirstPage(const SMGridViewLayoutSection *section) {
+    return section->firstPage;
+}
+
+long SMGridViewLayoutSectionGetPageCount(const SMGridViewLayoutSection *section) {
+    return section->pageCount;
+}
+
+long SMGridViewLayoutSectionPageForItem(const SMGridViewLayoutSection *section, size_t index) {
+    if (section->itemsPerPage == 0) {
+        return section->firstPage;
+    }
+    return section->firstPage + (long)index / section->itemsPerPage;
+}
+
+size_t SMGridViewLayoutSectionPagingRowForItem(const SMGridViewLayoutSection *section, size_t index) {
+    if (section->itemsPerPage == 0) {
+        return 0;
+    }
+    return (index / section->itemsPerRow) % (section->itemsPerPage / section->itemsPerRow);
+}
+
+bool SMGridViewLayoutSectionIsFirstOfPage(const SMGridViewLayoutSection *section, size_t index, bool inverseOrder) {
+    if (section->itemsPerPage == 0) {
+        return true;
+    }
+    if (inverseOrder) {
+        return (index % section->itemsPerRow) == 0;
+    }
+    return (long)(index % section->itemsPerPage) < (section->itemsPerPage / section->itemsPerRow);
+}
+
+long SMGridViewLayoutClosestPage(double offset, double pageSize, long numberOfPages) {
+    if (numberOfPages <= 0 || pageSize <= 0) {
+        return 0;
+    }
+    long page = (long)ceil(offset / pageSize - 0.5);
+    return SMGridViewLayoutMax(0, SMGridViewLayoutMin(page, numberOfPages - 1));
+}
+
+
+// Same size sections
+
+bool SMGridViewLayoutSectionIsUniform(const SMGridViewLayoutSection *section) {
+    return section->uniform;
+}
+
+SMGridViewLayoutSize SMGridViewLayoutSectionGetUniformSize(const SMGridViewLayoutSection *section) {
+    return section->uniformSize;
+}
+
+double SMGridViewLayoutSectionGetUniformStart(const SMGridViewLayoutSection *section) {
+    return section->uniformStart;
+}
+
+void SMGridViewLayoutSectionUseUniformSize(SMGridViewLayoutSection *section, SMGridViewLayoutSize size) {
+    section->uniformSize = size;
+    if (section->uniform) {
+        return;
+    }
+    section->sparseCount = 0;
+    for (size_t i = 0; i < section->count; i++) {
+        if (section->flags[i]) {
+            SMGridViewLayoutSparseSet(section, i, section->flags[i]);
+        }
+    }
+    free(section->rectStorage);
+    free(section->flagStorage);
+    free(section->indexMinStorage);
+    free(section->indexMaxStorage);
+    free(section->indexOrder);
+    free(section->checkpoints);
+    section->rectStorage = NULL;
+    section->flagStorage = NULL;
+    section->indexMinStorage = NULL;
+    section->indexMaxStorage = NULL;
+    section->indexOrder = NULL;
+    section->checkpoints = NULL;
+    section->origin = 0;
+    section->offset = 0;
+    SMGridViewLayoutUpdateItemPointers(section);
+    section->capacity = 0;
+    section->indexCapacity = 0;
+    section->indexValidCount = 0;
+    SMGridViewLayoutClearCheckpoints(section);
+    section->checkpointCapacity = 0;
+    section->uniform = true;
+    section->layoutCount = section->count;
+}
+
+void SMGridViewLayoutSectionUsePerItemRects(SMGridViewLayoutSection *section) {
+    if (!section->uniform) {
+        return;
+    }
+    section->uniform = false;
+    SMGridViewLayoutEnsureCapacity(section, section->count);
+    if (section->count > 0) {
+        memset(section->rects, 0, section->count * sizeof(SMGridViewLayoutRect));
+        memset(section->flags, 0, section->count * sizeof(uint8_t));
+    }
+    for (size_t i = 0; i < section->sparseCount; i++) {
+        if (section->sparseFlags[i].row < section->count) {
+            section->flags[section->sparseFlags[i].row] = section->sparseFlags[i].flags;
+        }
+    }
+    section->sparseCount = 0;
+    section->layoutCount = 0;
+}
+
+static double SMGridViewLayoutUniformStep(const SMGridViewLayoutSection *section) {
+    return (section->uniformParams.vertical ? section->uniformSize.height : section->uniformSize.width) + section->uniformParams.padding;
+}
+
+// Where the first line of a page starts. Page 0 starts after the header, like in the per item layout
+static double SMGridViewLayoutUniformStartOfPage(const SMGridViewLayoutSection *section, long page) {
+    return page == 0 ? section->uniformStart : page * (double)section->uniformParams.pageSize + section->uniformParams.padding;
+}
+
+static size_t SMGridViewLayoutUniformRow(const SMGridViewLayoutSection *section, size_t index) {
+    size_t rows = SMGridViewLayoutMax(section->numberOfRows, 1);
+    if (section->uniformParams.pageSize > 0 && section->uniformParams.inverseOrder) {
+        return section->itemsPerPage > 0 ? (index / section->itemsPerRow) % rows : 0;
+    }
+    return index % rows;
+}
+
+static SMGridViewLayoutRect SMGridViewLayoutUniformRect(const SMGridViewLayoutSection *section, size_t index) {
+    SMGridViewLayoutParams params = section->uniformParams;
+    size_t rows = SMGridViewLayoutMax(section->numberOfRows, 1);
+    double main;
+    if (params.pageSize == 0) {
+        main = section->uniformStart + (index / rows) * SMGridViewLayoutUniformStep(section);
+    } else if (section->itemsPerPage == 0) {
+        // Items don't fit in a page, they all go to the first one
+        main = SMGridViewLayoutUniformStartOfPage(section, section->firstPage);
+    } else {
+        size_t inPage = index % section->itemsPerPage;
+        size_t line = params.inverseOrder ? inPage % section->itemsPerRow : inPage / rows;
+        main = SMGridViewLayoutUniformStartOfPage(section, SMGridViewLayoutSectionPageForItem(section, index)) + line * SMGridViewLayoutUniformStep(section);
+    }
+    size_t row = SMGridViewLayoutUniformRow(section, index);
+    SMGridViewLayoutSize size = section->uniformSize;
+    SMGridViewLayoutRect rect = {0, 0, size.width, size.height};
+    if (params.vertical) {
+        rect.x = row * (size.width + params.padding) + params.padding;
+        rect.y = main;
+    } else {
+        rect.x = main;
+        rect.y = row * (size.height + params.padding) + params.padding;
+    }
+    return rect;
+}
+
+typedef struct {
+    size_t location;
+    size_t length;
+} SMGridViewLayoutLines;
+
+// Lines of items starting at lineStart that intersect [start, end)
+static SMGridViewLayoutLines SMGridViewLayoutUniformLines(const SMGridViewLayoutSection *section, double start, double end, double lineStart, size_t maxLines) {
+    SMGridViewLayoutLines lines = {0, 0};
+    double size = section->uniformParams.vertical ? section->uniformSize.height : section->uniformSize.width;
+    double step = size + section->uniformParams.padding;
+    if (step <= 0) {
+        if (lineStart < end && lineStart + size > start) {
+            lines.length = maxLines;
+        }
+        return lines;
+    }
+    // Line n intersects when lineStart + n * step < end and lineStart + n * step + size > start
+    double first = floor((start - lineStart - size) / step) + 1;
+    double last = ceil((end - lineStart) / step);
+    size_t firstLine = (size_t)SMGridViewLayoutMin(SMGridViewLayoutMax(first, 0), (double)maxLines);
+    size_t lastLine = (size_t)SMGridViewLayoutMin(SMGridViewLayoutMax(last, 0), (double)maxLines);
+    lines.location = firstLine;
+    lines.length = lastLine > firstLine ? lastLine - firstLine : 0;
+    return lines;
+}
+
+static void SMGridViewLayoutEnumerateUniformItems(const SMGridViewLayoutSection *section, double start, double end, SMGridViewLayoutItemCallback callback, void *context) {
+    if (section->count == 0 || start >= end) {
+        return;
+    }
+    size_t rows = SMGridViewLayoutMax(section->numberOfRows, 1);
+    double pageSize = section->uniformParams.pageSize;
+    bool stop = false;
+    if (pageSize == 0) {
+        SMGridViewLayoutLines lines = SMGridViewLayoutUniformLines(section, start, end, section->uniformStart, (section->count + rows - 1) / rows);
+        size_t last = SMGridViewLayoutMin((lines.location + lines.length) * rows, section->count);
+        for (size_t i = lines.location * rows; i < last && !stop; i++) {
+            callback(i, context, &stop);
+        }
+        return;
+    }
+    if (section->itemsPerPage == 0) {
+        SMGridViewLayoutLines lines = SMGridViewLayoutUniformLines(section, start, end, SMGridViewLayoutUniformStartOfPage(section, section->firstPage), 1);
+        for (size_t i = 0; lines.length > 0 && i < section->count && !stop; i++) {
+            callback(i, context, &stop);
+        }
+        return;
+    }
+    // One page before the range too, the first page of a section can go past its end after the header
+    long firstPage = SMGridViewLayoutMax(section->firstPage, (long)floor(start / pageSize) - 1);
+    long lastPage = SMGridViewLayoutMin(section->firstPage + section->pageCount - 1, (long)floor(end / pageSize));
+    for (long page = firstPage; page <= lastPage && !stop; page++) {
+        size_t base = (page - section->firstPage) * section->itemsPerPage;
+        SMGridViewLayoutLines lines = SMGridViewLayoutUniformLines(section, start, end, SMGridViewLayoutUniformStartOfPage(section, page), section->itemsPerRow);
+        for (size_t row = 0; row < rows && !stop; row++) {
+            for (size_t line = lines.location; line < lines.location + lines.length && !stop; line++) {
+                size_t index = base + (section->uniformParams.inverseOrder ? row * section->itemsPerRow + line : line * rows + row);
+                if (index < section->count) {
+                    callback(index, context, &stop);
+                }
+            }
+        }
+    }
+}
+
+void SMGridViewLayoutSectionLayoutUniform(SMGridViewLayoutSection *section, double start, SMGridViewLayoutParams params) {
+    section->uniformStart = start;
+    section->uniformParams = params;
+    section->layoutCount = section->count;
+    size_t tail = params.pageSize > 0 ? SMGridViewLayoutMax((size_t)section->itemsPerPage, section->numberOfRows) : section->numberOfRows;
+    for (size_t i = section->count; i > 0 && i + tail > section->count; i--) {
+        size_t row = SMGridViewLayoutUniformRow(section, i - 1);
+        SMGridViewLayoutRect rect = SMGridViewLayoutUniformRect(section, i - 1);
+        double value = (params.vertical ? rect.y + rect.height : rect.x + rect.width) + params.padding;
+        if (row < section->numberOfRows && value > section->positions[row]) {
+            section->positions[row] = value;
+        }
+    }
+    SMGridViewLayoutUpdateMaxPosition(section);
+}
+
+
+// Sections
+
+size_t SMGridViewLayoutBoundsSearch(const SMGridViewLayoutBounds *bounds, size_t count, double pos, bool useEnd, bool orAt) {
+    size_t low = 0;
+    size_t high = count;
+    while (low < high) {
+        size_t mid = (low + high) / 2;
+        double value = useEnd ? bounds[mid].end : bounds[mid].start;
+        if (value > pos || (orAt && value == pos)) {
+            high = mid;
+        } else {
+            low = mid + 1;
+        }
+    }
+    return low;
+}
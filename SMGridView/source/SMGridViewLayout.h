@@ -0,0 +1,169 @@
+//
+//  SMGridViewLayout.h
+//  SMGridView
+//
+
+#ifndef SMGridViewLayout_h
+#define SMGridViewLayout_h
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ Layout core of SMGridView. It only depends on the C standard library, so all the layout math
+ (row positions, rects, paging, the interval index, same size sections) can be built and profiled
+ without UIKit. SMGridView drives it: it asks its dataSource for sizes and passes them here.
+
+ Positions are on the main axis, the one that scrolls (y when vertical).
+ */
+
+#define SMGridViewLayoutNotFound SIZE_MAX
+// Every how many items the row positions are saved so layout can resume from there
+#define SMGridViewLayoutCheckpointInterval 64
+
+// Origins are doubles: a section of millions of items is hundreds of millions of points long, where a float
+// is off by tens of points. Sizes stay floats, so an item costs 24 bytes of geometry plus 1 of flags, 25 in all.
+// That is above the ~20 bytes per item aimed for, the price of the double origins
+typedef struct {
+    double x;
+    double y;
+    float width;
+    float height;
+} SMGridViewLayoutRect;
+
+typedef struct {
+    float width;
+    float height;
+} SMGridViewLayoutSize;
+
+typedef struct {
+    float padding;
+    bool vertical;
+    // Main axis size of a page, 0 if not paging
+    float pageSize;
+    bool inverseOrder;
+} SMGridViewLayoutParams;
+
+// Main axis extent of a section, from its header to the end of its items
+typedef struct {
+    double start;
+    double end;
+} SMGridViewLayoutBounds;
+
+typedef void (*SMGridViewLayoutItemCallback)(size_t index, void *context, bool *stop);
+
+typedef struct SMGridViewLayoutSection SMGridViewLayoutSection;
+
+SMGridViewLayoutSection *SMGridViewLayoutSectionCreate(void);
+void SMGridViewLayoutSectionFree(SMGridViewLayoutSection *section);
+
+// Items
+
+size_t SMGridViewLayoutSectionGetCount(const SMGridViewLayoutSection *section);
+void SMGridViewLayoutSectionSetCount(SMGridViewLayoutSection *section, size_t count);
+// Only the first layoutCount items have a rect
+size_t SMGridViewLayoutSectionGetLayoutCount(const SMGridViewLayoutSection *section);
+void SMGridViewLayoutSectionSetLayoutCount(SMGridViewLayoutSection *section, size_t layoutCount);
+void SMGridViewLayoutSectionInsertItem(SMGridViewLayoutSection *section, size_t index);
+// New items have no rect or flags, the ones from index on move count places. At index 0 nothing is moved,
+// the new items take free slots before the first one
+void SMGridViewLayoutSectionInsertItems(SMGridViewLayoutSection *section, size_t index, size_t count);
+void SMGridViewLayoutSectionRemoveItem(SMGridViewLayoutSection *section, size_t index);
+void SMGridViewLayoutSectionMoveItem(SMGridViewLayoutSection *section, size_t fromIndex, size_t toIndex);
+SMGridViewLayoutRect SMGridViewLayoutSectionGetRect(const SMGridViewLayoutSection *section, size_t index);
+void SMGridViewLayoutSectionSetRect(SMGridViewLayoutSection *section, size_t index, SMGridViewLayoutRect rect);
+uint8_t SMGridViewLayoutSectionGetFlags(const SMGridViewLayoutSection *section, size_t index);
+void SMGridViewLayoutSectionSetFlags(SMGridViewLayoutSection *section, size_t index, uint8_t flags);
+SMGridViewLayoutRect SMGridViewLayoutSectionGetHeaderRect(const SMGridViewLayoutSection *section);
+void SMGridViewLayoutSectionSetHeaderRect(SMGridViewLayoutSection *section, SMGridViewLayoutRect rect);
+
+// Calls back with the items intersecting [start, end) on the main axis, found with binary searches
+void SMGridViewLayoutSectionEnumerateItems(SMGridViewLayoutSection *section, double start, double end, bool vertical, SMGridViewLayoutItemCallback callback, void *context);
+
+// Row positions
+
+// Main axis position where the next item of each row goes
+double *SMGridViewLayoutSectionGetPositions(const SMGridViewLayoutSection *section);
+size_t SMGridViewLayoutSectionGetNumberOfRows(const SMGridViewLayoutSection *section);
+// Running max of positions, so the section extent doesn't need to look at every row
+double SMGridViewLayoutSectionGetMaxPosition(const SMGridViewLayoutSection *section);
+double SMGridViewLayoutSectionGetLayoutStart(const SMGridViewLayoutSection *section);
+void SMGridViewLayoutSectionSetLayoutStart(SMGridViewLayoutSection *section, double layoutStart);
+void SMGridViewLayoutSectionResetPositions(SMGridViewLayoutSection *section, size_t rows, double value);
+void SMGridViewLayoutSectionSetPosition(SMGridViewLayoutSection *section, size_t row, double value);
+void SMGridViewLayoutSectionExtendPositions(SMGridViewLayoutSection *section, size_t rows, double value);
+// Row positions are saved every checkpoint interval items, so layout can resume from there
+void SMGridViewLayoutSectionSaveCheckpoint(SMGridViewLayoutSection *section, size_t index);
+// Restores the checkpoint before index and returns the item it belongs to, SMGridViewLayoutNotFound if none
+size_t SMGridViewLayoutSectionRestoreCheckpoint(SMGridViewLayoutSection *section, size_t index);
+// Moves the whole section. Rects are kept relative to an offset, so it costs one step per row, not per item
+void SMGridViewLayoutSectionShift(SMGridViewLayoutSection *section, double delta, bool vertical);
+// Moves the laid out items from index on, without touching the row positions. Every row has to have moved by delta
+// after index, so the checkpoints saved there move too. Touches the items on the shorter side of index
+void SMGridViewLayoutSectionShiftItems(SMGridViewLayoutSection *section, size_t index, double delta, bool vertical);
+
+// Placement
+
+// Row where the item goes: the shortest one, or the one given by paging in inverse order
+size_t SMGridViewLayoutSectionRowForItem(const SMGridViewLayoutSection *section, size_t index, SMGridViewLayoutParams params);
+SMGridViewLayoutRect SMGridViewLayoutSectionRectForItem(const SMGridViewLayoutSection *section, size_t index, size_t row, SMGridViewLayoutSize size, SMGridViewLayoutParams params);
+// Moves the position of row after rect
+void SMGridViewLayoutSectionAdvanceRow(SMGridViewLayoutSection *section, size_t row, SMGridViewLayoutRect rect, SMGridViewLayoutParams params);
+/**
+ Moves an item and lays out again, with the sizes already in the rects, from the checkpoint before the move
+ to the first checkpoint after it. Returns true if the rows there are the same as before, then the rest of
+ the section didn't change and neither did its extent. Otherwise the caller has to lay it out from the move on
+ */
+bool SMGridViewLayoutSectionMoveItemAndRelayout(SMGridViewLayoutSection *section, size_t fromIndex, size_t toIndex, SMGridViewLayoutParams params);
+/**
+ Inserts count items at the start with the given sizes and lays them out from the checkpoint before item 0.
+ If every row moved by the same amount, the items after them move through the offset: only the new items
+ are written, the index and the checkpoints stay valid. Returns false otherwise, or when the section is same size,
+ paging or was never laid out; the items are inserted with their sizes and the caller lays out the section again
+ */
+bool SMGridViewLayoutSectionPrependItems(SMGridViewLayoutSection *section, const SMGridViewLayoutSize *sizes, size_t count, uint8_t flags, SMGridViewLayoutParams params);
+
+// Paging
+
+// Set every time the section is laid out, pageCount is computed from the count
+void SMGridViewLayoutSectionSetPaging(SMGridViewLayoutSection *section, long itemsPerRow, long itemsPerPage, long firstPage);
+long SMGridViewLayoutSectionGetItemsPerRow(const SMGridViewLayoutSection *section);
+long SMGridViewLayoutSectionGetItemsPerPage(const SMGridViewLayoutSection *section);
+long SMGridViewLayoutSectionGetFirstPage(const SMGridViewLayoutSection *section);
+long SMGridViewLayoutSectionGetPageCount(const SMGridViewLayoutSection *section);
+long SMGridViewLayoutSectionPageForItem(const SMGridViewLayoutSection *section, size_t index);
+size_t SMGridViewLayoutSectionPagingRowForItem(const SMGridViewLayoutSection *section, size_t index);
+bool SMGridViewLayoutSectionIsFirstOfPage(const SMGridViewLayoutSection *section, size_t index, bool inverseOrder);
+// Pages are one pageSize apart, rounding is enough. On a tie the previous page wins
+long SMGridViewLayoutClosestPage(double offset, double pageSize, long numberOfPages);
+
+// Same size sections
+
+/**
+ A uniform section keeps no per item arrays: rects and the items in a range are computed from the item size,
+ and the few non zero flags are kept in a sparse list. Memory doesn't depend on the number of items.
+ */
+bool SMGridViewLayoutSectionIsUniform(const SMGridViewLayoutSection *section);
+SMGridViewLayoutSize SMGridViewLayoutSectionGetUniformSize(const SMGridViewLayoutSection *section);
+double SMGridViewLayoutSectionGetUniformStart(const SMGridViewLayoutSection *section);
+void SMGridViewLayoutSectionUseUniformSize(SMGridViewLayoutSection *section, SMGridViewLayoutSize size);
+// Rects have to be laid out again after this
+void SMGridViewLayoutSectionUsePerItemRects(SMGridViewLayoutSection *section);
+// Row positions must have been reset to the start of the items. Only the last line (or page) is looked at to move them
+void SMGridViewLayoutSectionLayoutUniform(SMGridViewLayoutSection *section, double start, SMGridViewLayoutParams params);
+
+// Sections
+
+// First section whose start (or end) is after pos, or at pos when orAt. count if there is none
+size_t SMGridViewLayoutBoundsSearch(const SMGridViewLayoutBounds *bounds, size_t count, double pos, bool useEnd, bool orAt);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
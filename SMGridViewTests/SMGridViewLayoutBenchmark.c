@@ -0,0 +1,393 @@
+//
+//  SMGridViewLayoutBenchmark.c
+//  SMGridView
+//
+
+#define _POSIX_C_SOURCE 199309L
+
+#include "SMGridViewLayout.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/**
+ Headless benchmark of the layout core: the layout work of reloads, scroll sweeps, appends, prepends,
+ add/remove and sort moves, without UIKit. The grid level costs (views, dataSource calls) are measured
+ by SMGridViewBenchmark in the example app.
+
+ Usage: SMGridViewLayoutBenchmark [--save] [--max-regression 0.2] baseline
+
+ Every case runs a few times and the fastest one counts. If the baseline file doesn't exist (or with --save)
+ the run is saved there. Otherwise any case slower than the baseline by more than max regression is reported
+ and the exit status is 1.
+ */
+
+#define kBenchmarkMaxCases 32
+#define kBenchmarkRuns 5
+#define kBenchmarkRows 5
+
+static const SMGridViewLayoutParams kBenchmarkParams = {5, true, 0, false};
+static const double kBenchmarkScreen = 480;
+// Sweeps go this many screens down the grid and back
+static const size_t kBenchmarkSweepScreens = 40;
+static const size_t kBenchmarkSweepStepsPerScreen = 30;
+static const size_t kBenchmarkUpdates = 200;
+static const size_t kBenchmarkAppends = 50;
+static const size_t kBenchmarkAppendSize = 100;
+
+typedef struct {
+    char name[64];
+    double nsPerOp;
+} SMBenchmarkResult;
+
+typedef struct {
+    SMBenchmarkResult results[kBenchmarkMaxCases];
+    size_t count;
+    SMBenchmarkResult baseline[kBenchmarkMaxCases];
+    size_t baselineCount;
+    double maxRegression;
+    int regressions;
+} SMBenchmark;
+
+// Case state, set up once and run kBenchmarkRuns times
+typedef struct {
+    SMGridViewLayoutSection *section;
+    size_t count;
+    bool uniform;
+    size_t visited;
+} SMBenchmarkState;
+
+typedef void (*SMBenchmarkSetupFunction)(SMBenchmarkState *state);
+typedef size_t (*SMBenchmarkBlock)(SMBenchmarkState *state);
+
+static double SMBenchmarkNow(void) {
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return time.tv_sec + time.tv_nsec * 1e-9;
+}
+
+// Sizes come from the item so runs are repeatable
+static SMGridViewLayoutSize SMBenchmarkSize(size_t index, bool uniform) {
+    static const float heights[] = {50, 70, 90, 110};
+    SMGridViewLayoutSize size = {50, uniform ? 50 : heights[(index * 7) % 4]};
+    return size;
+}
+
+// Same loop the grid runs for items [from, to), from the checkpoint before from
+static void SMBenchmarkLayoutItems(SMGridViewLayoutSection *section, size_t from, size_t to) {
+    size_t start = SMGridViewLayoutSectionRestoreCheckpoint(section, from);
+    if (start == SMGridViewLayoutNotFound) {
+        start = 0;
+        SMGridViewLayoutSectionResetPositions(section, kBenchmarkRows, kBenchmarkParams.padding);
+    }
+    for (size_t i = start; i < to; i++) {
+        SMGridViewLayoutSectionSaveCheckpoint(section, i);
+        size_t row = SMGridViewLayoutSectionRowForItem(section, i, kBenchmarkParams);
+        SMGridViewLayoutSize size = {SMGridViewLayoutSectionGetRect(section, i).width, SMGridViewLayoutSectionGetRect(section, i).height};
+        if (size.height == 0) {
+            size = SMBenchmarkSize(i, false);
+        }
+        SMGridViewLayoutRect rect = SMGridViewLayoutSectionRectForItem(section, i, row, size, kBenchmarkParams);
+        SMGridViewLayoutSectionSetRect(section, i, rect);
+        SMGridViewLayoutSectionAdvanceRow(section, row, rect, kBenchmarkParams);
+    }
+    SMGridViewLayoutSectionSetLayoutCount(section, to);
+}
+
+static void SMBenchmarkSetup(SMBenchmarkState *state, size_t count, bool uniform) {
+    SMGridViewLayoutSectionFree(state->section);
+    state->section = SMGridViewLayoutSectionCreate();
+    state->count = count;
+    state->uniform = uniform;
+    SMGridViewLayoutSectionSetCount(state->section, count);
+    if (uniform) {
+        SMGridViewLayoutSectionUseUniformSize(state->section, SMBenchmarkSize(0, true));
+    }
+}
+
+static void SMBenchmarkReload(SMBenchmarkState *state) {
+    SMGridViewLayoutSection *section = state->section;
+    if (state->uniform) {
+        SMGridViewLayoutSectionResetPositions(section, kBenchmarkRows, kBenchmarkParams.padding);
+        SMGridViewLayoutSectionLayoutUniform(section, kBenchmarkParams.padding, kBenchmarkParams);
+        return;
+    }
+    // Sizes are asked again on a reload
+    SMGridViewLayoutSectionSetLayoutCount(section, 0);
+    for (size_t i = 0; i < state->count; i++) {
+        SMGridViewLayoutSize size = SMBenchmarkSize(i, false);
+        SMGridViewLayoutRect rect = {0, 0, size.width, size.height};
+        SMGridViewLayoutSectionSetRect(section, i, rect);
+    }
+    SMBenchmarkLayoutItems(section, 0, state->count);
+}
+
+
+// Cases
+
+static size_t SMBenchmarkReloadBlock(SMBenchmarkState *state) {
+    SMBenchmarkReload(state);
+    return 1;
+}
+
+static void SMBenchmarkCountItem(size_t index, void *context, bool *stop) {
+    ((SMBenchmarkState *)context)->visited++;
+}
+
+static size_t SMBenchmarkSweepBlock(SMBenchmarkState *state) {
+    double step = kBenchmarkScreen / kBenchmarkSweepStepsPerScreen;
+    size_t steps = kBenchmarkSweepScreens * kBenchmarkSweepStepsPerScreen;
+    for (size_t i = 0; i < steps; i++) {
+        SMGridViewLayoutSectionEnumerateItems(state->section, i * step, i * step + kBenchmarkScreen, true, SMBenchmarkCountItem, state);
+    }
+    for (size_t i = steps; i > 0; i--) {
+        SMGridViewLayoutSectionEnumerateItems(state->section, (i - 1) * step, (i - 1) * step + kBenchmarkScreen, true, SMBenchmarkCountItem, state);
+    }
+    return steps * 2;
+}
+
+static size_t SMBenchmarkAppendBlock(SMBenchmarkState *state) {
+    SMBenchmarkSetup(state, kBenchmarkAppendSize, false);
+    SMBenchmarkReload(state);
+    for (size_t i = 0; i < kBenchmarkAppends; i++) {
+        size_t first = state->count;
+        state->count += kBenchmarkAppendSize;
+        SMGridViewLayoutSectionSetCount(state->section, state->count);
+        SMBenchmarkLayoutItems(state->section, first, state->count);
+    }
+    return kBenchmarkAppends;
+}
+
+// Like the grid: the new items are laid out from the start, the old ones move by the space they take
+// if every row grew the same, otherwise the section is laid out again
+static size_t SMBenchmarkPrependBlock(SMBenchmarkState *state) {
+    SMBenchmarkSetup(state, kBenchmarkAppendSize, false);
+    SMBenchmarkReload(state);
+    SMGridViewLayoutSize sizes[kBenchmarkAppendSize];
+    for (size_t j = 0; j < kBenchmarkAppendSize; j++) {
+        sizes[j] = SMBenchmarkSize(j, false);
+    }
+    for (size_t i = 0; i < kBenchmarkAppends; i++) {
+        state->count += kBenchmarkAppendSize;
+        if (!SMGridViewLayoutSectionPrependItems(state->section, sizes, kBenchmarkAppendSize, 0, kBenchmarkParams)) {
+            SMBenchmarkLayoutItems(state->section, 0, state->count);
+        }
+    }
+    return kBenchmarkAppends;
+}
+
+// Pages of same height items before a large section, like older messages loaded in a chat.
+// Every row grows the same, so only the new items are laid out
+static size_t SMBenchmarkPrependPageBlock(SMBenchmarkState *state) {
+    SMGridViewLayoutSize sizes[kBenchmarkAppendSize];
+    for (size_t j = 0; j < kBenchmarkAppendSize; j++) {
+        sizes[j] = SMBenchmarkSize(0, true);
+    }
+    for (size_t i = 0; i < kBenchmarkAppends; i++) {
+        state->count += kBenchmarkAppendSize;
+        if (!SMGridViewLayoutSectionPrependItems(state->section, sizes, kBenchmarkAppendSize, 0, kBenchmarkParams)) {
+            SMBenchmarkLayoutItems(state->section, 0, state->count);
+        }
+    }
+    return kBenchmarkAppends;
+}
+
+// One insert and one remove, each lays out from the changed item on
+static size_t SMBenchmarkAddRemoveBlock(SMBenchmarkState *state) {
+    for (size_t i = 0; i < kBenchmarkUpdates; i++) {
+        size_t index = (i * 37) % state->count;
+        SMGridViewLayoutSectionInsertItem(state->section, index);
+        state->count++;
+        SMBenchmarkLayoutItems(state->section, index, state->count);
+        SMGridViewLayoutSectionRemoveItem(state->section, index);
+        state->count--;
+        SMBenchmarkLayoutItems(state->section, index, state->count);
+    }
+    return kBenchmarkUpdates * 2;
+}
+
+// The moves a drag to sort does, one neighbour at a time, and the fallback when they aren't local
+static size_t SMBenchmarkSortSwapBlock(SMBenchmarkState *state) {
+    for (size_t i = 0; i < kBenchmarkUpdates; i++) {
+        if (!SMGridViewLayoutSectionMoveItemAndRelayout(state->section, i, i + 1, kBenchmarkParams)) {
+            SMBenchmarkLayoutItems(state->section, i, state->count);
+        }
+    }
+    return kBenchmarkUpdates;
+}
+
+// Finding the sections on screen in a grid of many sections
+static size_t SMBenchmarkBoundsSearchBlock(SMBenchmarkState *state) {
+    size_t count = 10000;
+    SMGridViewLayoutBounds *bounds = malloc(count * sizeof(SMGridViewLayoutBounds));
+    for (size_t i = 0; i < count; i++) {
+        bounds[i].start = i * 1000.0;
+        bounds[i].end = i * 1000.0 + 1000;
+    }
+    size_t queries = 100000;
+    for (size_t i = 0; i < queries; i++) {
+        double pos = (i * 7919) % (count * 1000);
+        state->visited += SMGridViewLayoutBoundsSearch(bounds, count, pos, true, false);
+        state->visited += SMGridViewLayoutBoundsSearch(bounds, count, pos + kBenchmarkScreen, false, false);
+    }
+    free(bounds);
+    return queries * 2;
+}
+
+
+// Runner
+
+static const SMBenchmarkResult *SMBenchmarkFind(const SMBenchmarkResult *results, size_t count, const char *name) {
+    for (size_t i = 0; i < count; i++) {
+        if (strcmp(results[i].name, name) == 0) {
+            return results + i;
+        }
+    }
+    return NULL;
+}
+
+// Only the time inside block is measured, setup runs before every run. Block returns the number of operations it did
+static void SMBenchmarkMeasure(SMBenchmark *benchmark, SMBenchmarkState *state, const char *name, SMBenchmarkSetupFunction setup, SMBenchmarkBlock block) {
+    double best = -1;
+    size_t ops = 1;
+    for (int run = 0; run < kBenchmarkRuns; run++) {
+        if (setup) {
+            setup(state);
+        }
+        double start = SMBenchmarkNow();
+        ops = block(state);
+        double time = SMBenchmarkNow() - start;
+        if (best < 0 || time < best) {
+            best = time;
+        }
+    }
+    ops = ops > 0 ? ops : 1;
+    SMBenchmarkResult *result = benchmark->results + benchmark->count++;
+    snprintf(result->name, sizeof(result->name), "%s", name);
+    result->nsPerOp = best * 1e9 / ops;
+
+    const SMBenchmarkResult *baseline = SMBenchmarkFind(benchmark->baseline, benchmark->baselineCount, name);
+    if (baseline && result->nsPerOp > baseline->nsPerOp * (1 + benchmark->maxRegression)) {
+        benchmark->regressions++;
+        printf("%s: %.0f ns/op, %zu ops REGRESSION (baseline %.0f ns/op)\n", name, result->nsPerOp, ops, baseline->nsPerOp);
+        fprintf(stderr, "REGRESSION %s: %.0f ns/op, baseline %.0f ns/op\n", name, result->nsPerOp, baseline->nsPerOp);
+    } else {
+        printf("%s: %.0f ns/op, %zu ops\n", name, result->nsPerOp, ops);
+    }
+}
+
+// One case per line: the name, a tab and the ns/op
+static bool SMBenchmarkLoadBaseline(SMBenchmark *benchmark, const char *path) {
+    FILE *file = fopen(path, "r");
+    if (!file) {
+        return false;
+    }
+    char line[128];
+    while (fgets(line, sizeof(line), file) && benchmark->baselineCount < kBenchmarkMaxCases) {
+        char *tab = strchr(line, '\t');
+        if (line[0] == '#' || !tab) {
+            continue;
+        }
+        *tab = '\0';
+        SMBenchmarkResult *result = benchmark->baseline + benchmark->baselineCount++;
+        snprintf(result->name, sizeof(result->name), "%s", line);
+        result->nsPerOp = strtod(tab + 1, NULL);
+    }
+    fclose(file);
+    return true;
+}
+
+static bool SMBenchmarkSaveBaseline(const SMBenchmark *benchmark, const char *path) {
+    FILE *file = fopen(path, "w");
+    if (!file) {
+        return false;
+    }
+    fprintf(file, "# SMGridViewLayoutBenchmark baseline, ns/op. Saved with --save\n");
+    for (size_t i = 0; i < benchmark->count; i++) {
+        fprintf(file, "%s\t%.1f\n", benchmark->results[i].name, benchmark->results[i].nsPerOp);
+    }
+    fclose(file);
+    return true;
+}
+
+static void SMBenchmarkSetupReload1000(SMBenchmarkState *state) {
+    SMBenchmarkSetup(state, 1000, false);
+}
+
+static void SMBenchmarkSetupReload100000(SMBenchmarkState *state) {
+    SMBenchmarkSetup(state, 100000, false);
+}
+
+static void SMBenchmarkSetupUniform1000000(SMBenchmarkState *state) {
+    SMBenchmarkSetup(state, 1000000, true);
+}
+
+static void SMBenchmarkSetupLaidOut100000(SMBenchmarkState *state) {
+    SMBenchmarkSetup(state, 100000, false);
+    SMBenchmarkReload(state);
+}
+
+static void SMBenchmarkSetupUniformLaidOut100000(SMBenchmarkState *state) {
+    SMBenchmarkSetup(state, 100000, true);
+    SMBenchmarkReload(state);
+}
+
+static void SMBenchmarkSetupLaidOut10000(SMBenchmarkState *state) {
+    SMBenchmarkSetup(state, 10000, false);
+    SMBenchmarkReload(state);
+}
+
+int main(int argc, char **argv) {
+    SMBenchmark benchmark;
+    memset(&benchmark, 0, sizeof(benchmark));
+    benchmark.maxRegression = 0.2;
+    bool save = false;
+    const char *path = NULL;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--save") == 0) {
+            save = true;
+        } else if (strcmp(argv[i], "--max-regression") == 0 && i + 1 < argc) {
+            benchmark.maxRegression = strtod(argv[++i], NULL);
+        } else {
+            path = argv[i];
+        }
+    }
+    if (!path) {
+        fprintf(stderr, "Usage: %s [--save] [--max-regression 0.2] baseline\n", argv[0]);
+        return 2;
+    }
+    if (!save && !SMBenchmarkLoadBaseline(&benchmark, path)) {
+        save = true;
+    }
+
+    SMBenchmarkState state;
+    memset(&state, 0, sizeof(state));
+    SMBenchmarkMeasure(&benchmark, &state, "reload 1000", SMBenchmarkSetupReload1000, SMBenchmarkReloadBlock);
+    SMBenchmarkMeasure(&benchmark, &state, "reload 100000", SMBenchmarkSetupReload100000, SMBenchmarkReloadBlock);
+    SMBenchmarkMeasure(&benchmark, &state, "reload 1000000 same size", SMBenchmarkSetupUniform1000000, SMBenchmarkReloadBlock);
+    SMBenchmarkMeasure(&benchmark, &state, "scroll sweep", SMBenchmarkSetupLaidOut100000, SMBenchmarkSweepBlock);
+    SMBenchmarkMeasure(&benchmark, &state, "scroll sweep same size", SMBenchmarkSetupUniformLaidOut100000, SMBenchmarkSweepBlock);
+    SMBenchmarkMeasure(&benchmark, &state, "append", NULL, SMBenchmarkAppendBlock);
+    SMBenchmarkMeasure(&benchmark, &state, "prepend", NULL, SMBenchmarkPrependBlock);
+    SMBenchmarkMeasure(&benchmark, &state, "prepend page 100000", SMBenchmarkSetupLaidOut100000, SMBenchmarkPrependPageBlock);
+    SMBenchmarkMeasure(&benchmark, &state, "add/remove", SMBenchmarkSetupLaidOut10000, SMBenchmarkAddRemoveBlock);
+    SMBenchmarkMeasure(&benchmark, &state, "sort swap", SMBenchmarkSetupLaidOut10000, SMBenchmarkSortSwapBlock);
+    SMBenchmarkMeasure(&benchmark, &state, "sections bounds search", NULL, SMBenchmarkBoundsSearchBlock);
+    SMGridViewLayoutSectionFree(state.section);
+
+    if (save) {
+        if (!SMBenchmarkSaveBaseline(&benchmark, path)) {
+            fprintf(stderr, "Could not save the baseline to %s\n", path);
+            return 2;
+        }
+        printf("Saved as baseline\n");
+        return 0;
+    }
+    if (benchmark.regressions > 0) {
+        fprintf(stderr, "%d cases slower than the baseline by more than %.0f%%\n", benchmark.regressions, benchmark.maxRegression * 100);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,598 @@
+//
+//  SMGridViewLayoutTests.c
+//  SMGridView
+//
+
+#include "SMGridViewLayout.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static int failures = 0;
+
+#define CHECK(condition) do { \
+    if (!(condition)) { \
+        fprintf(stderr, "%s:%d: %s failed\n", __FILE__, __LINE__, #condition); \
+        failures++; \
+    } \
+} while (0)
+
+static const SMGridViewLayoutParams kVerticalParams = {5, true, 0, false};
+
+// Heights repeat every 4 items, like the example app
+static float TestHeight(size_t index) {
+    static const float heights[] = {50, 70, 90, 110};
+    return heights[(index * 7) % 4];
+}
+
+// Lays out items [from, count) the way the grid does, resuming from the checkpoint before from
+static void TestLayout(SMGridViewLayoutSection *section, size_t rows, size_t from, size_t count, const float *heights, SMGridViewLayoutParams params) {
+    SMGridViewLayoutSectionSetCount(section, count);
+    size_t start = from == 0 ? SMGridViewLayoutNotFound : SMGridViewLayoutSectionRestoreCheckpoint(section, from);
+    if (start == SMGridViewLayoutNotFound) {
+        start = 0;
+        SMGridViewLayoutSectionResetPositions(section, rows, params.padding);
+    }
+    for (size_t i = start; i < count; i++) {
+        SMGridViewLayoutSectionSaveCheckpoint(section, i);
+        size_t row = SMGridViewLayoutSectionRowForItem(section, i, params);
+        SMGridViewLayoutSize size = {50, heights ? heights[i] : TestHeight(i)};
+        SMGridViewLayoutRect rect = SMGridViewLayoutSectionRectForItem(section, i, row, size, params);
+        SMGridViewLayoutSectionSetRect(section, i, rect);
+        SMGridViewLayoutSectionAdvanceRow(section, row, rect, params);
+    }
+    SMGridViewLayoutSectionSetLayoutCount(section, count);
+}
+
+static bool TestSameRect(SMGridViewLayoutRect rect1, SMGridViewLayoutRect rect2) {
+    return rect1.x == rect2.x && rect1.y == rect2.y && rect1.width == rect2.width && rect1.height == rect2.height;
+}
+
+typedef struct {
+    size_t *items;
+    size_t count;
+} TestItems;
+
+static void TestCollect(size_t index, void *context, bool *stop) {
+    TestItems *items = context;
+    items->items[items->count++] = index;
+}
+
+static int TestCompareIndexes(const void *index1, const void *index2) {
+    size_t i1 = *(const size_t *)index1;
+    size_t i2 = *(const size_t *)index2;
+    return i1 < i2 ? -1 : (i1 > i2 ? 1 : 0);
+}
+
+// Enumeration has to give the same items as looking at every rect
+static bool TestEnumerationMatches(SMGridViewLayoutSection *section, double start, double end, bool vertical) {
+    size_t count = SMGridViewLayoutSectionGetLayoutCount(section);
+    TestItems found = {malloc((count + 1) * sizeof(size_t)), 0};
+    SMGridViewLayoutSectionEnumerateItems(section, start, end, vertical, TestCollect, &found);
+    qsort(found.items, found.count, sizeof(size_t), TestCompareIndexes);
+    bool same = true;
+    size_t next = 0;
+    for (size_t i = 0; i < count && same; i++) {
+        SMGridViewLayoutRect rect = SMGridViewLayoutSectionGetRect(section, i);
+        double min = vertical ? rect.y : rect.x;
+        double max = min + (vertical ? rect.height : rect.width);
+        if (min < end && max > start) {
+            same = next < found.count && found.items[next] == i;
+            next++;
+        }
+    }
+    same = same && next == found.count;
+    free(found.items);
+    return same;
+}
+
+
+// Placement
+
+static void TestRowPlacement(void) {
+    SMGridViewLayoutSection *section = SMGridViewLayoutSectionCreate();
+    TestLayout(section, 3, 0, 3, NULL, kVerticalParams);
+    // First line fills the rows in order, from the padding
+    for (size_t i = 0; i < 3; i++) {
+        SMGridViewLayoutRect rect = SMGridViewLayoutSectionGetRect(section, i);
+        CHECK(rect.x == i * 55 + 5);
+        CHECK(rect.y == 5);
+    }
+    // Then the shortest row wins, ties go to the first one
+    double *positions = SMGridViewLayoutSectionGetPositions(section);
+    CHECK(SMGridViewLayoutSectionGetNumberOfRows(section) == 3);
+    CHECK(positions[0] == 5 + TestHeight(0) + 5);
+    size_t shortest = 0;
+    for (size_t row = 1; row < 3; row++) {
+        if (positions[row] < positions[shortest]) {
+            shortest = row;
+        }
+    }
+    CHECK(SMGridViewLayoutSectionRowForItem(section, 3, kVerticalParams) == shortest);
+    CHECK(SMGridViewLayoutSectionGetMaxPosition(section) == 5 + 110 + 5);
+
+    // Far down a section positions are big, the shortest row still wins
+    SMGridViewLayoutSectionResetPositions(section, 3, 2e6);
+    SMGridViewLayoutSectionSetPosition(section, 0, 2e6 + 10);
+    SMGridViewLayoutSectionSetPosition(section, 2, 2e6 + 5);
+    CHECK(SMGridViewLayoutSectionRowForItem(section, 0, kVerticalParams) == 1);
+    CHECK(SMGridViewLayoutSectionGetMaxPosition(section) == 2e6 + 10);
+
+    SMGridViewLayoutSectionResetPositions(section, 0, 0);
+    CHECK(SMGridViewLayoutSectionRowForItem(section, 0, kVerticalParams) == 0);
+
+    // Horizontal grids put rows on y
+    SMGridViewLayoutParams horizontal = {5, false, 0, false};
+    TestLayout(section, 2, 0, 4, NULL, horizontal);
+    SMGridViewLayoutRect rect = SMGridViewLayoutSectionGetRect(section, 1);
+    CHECK(rect.x == 5);
+    CHECK(rect.y == TestHeight(1) + 10);
+    SMGridViewLayoutSectionFree(section);
+}
+
+static void TestLargeCoordinates(void) {
+    // Hundreds of millions of points in, a float would be off by tens of points
+    SMGridViewLayoutSection *section = SMGridViewLayoutSectionCreate();
+    SMGridViewLayoutParams params = {0, true, 0, false};
+    SMGridViewLayoutSectionSetCount(section, 1000);
+    SMGridViewLayoutSectionResetPositions(section, 1, 4e8);
+    for (size_t i = 0; i < 1000; i++) {
+        SMGridViewLayoutSize size = {50, 1.5};
+        SMGridViewLayoutRect rect = SMGridViewLayoutSectionRectForItem(section, i, 0, size, params);
+        SMGridViewLayoutSectionSetRect(section, i, rect);
+        SMGridViewLayoutSectionAdvanceRow(section, 0, rect, params);
+    }
+    SMGridViewLayoutSectionSetLayoutCount(section, 1000);
+    CHECK(SMGridViewLayoutSectionGetRect(section, 999).y == 4e8 + 999 * 1.5);
+    CHECK(SMGridViewLayoutSectionGetMaxPosition(section) == 4e8 + 1500);
+    CHECK(TestEnumerationMatches(section, 4e8 + 300.75, 4e8 + 301, true));
+    SMGridViewLayoutSectionFree(section);
+}
+
+
+// Checkpoints
+
+static void TestCheckpoints(void) {
+    size_t count = 300;
+    SMGridViewLayoutSection *section = SMGridViewLayoutSectionCreate();
+    TestLayout(section, 4, 0, count, NULL, kVerticalParams);
+    SMGridViewLayoutRect *rects = malloc(count * sizeof(SMGridViewLayoutRect));
+    for (size_t i = 0; i < count; i++) {
+        rects[i] = SMGridViewLayoutSectionGetRect(section, i);
+    }
+    double finalPositions[4];
+    memcpy(finalPositions, SMGridViewLayoutSectionGetPositions(section), sizeof(finalPositions));
+
+    // The checkpoint before an item holds the rows before laying out the first item of its interval
+    CHECK(SMGridViewLayoutSectionRestoreCheckpoint(section, 130) == 128);
+    for (size_t row = 0; row < 4; row++) {
+        double expected = 5;
+        for (size_t i = 0; i < 128; i++) {
+            if (rects[i].x == row * 55 + 5) {
+                expected = fmax(expected, rects[i].y + rects[i].height + 5);
+            }
+        }
+        CHECK(SMGridViewLayoutSectionGetPositions(section)[row] == expected);
+    }
+
+    // Laying out again from a checkpoint gives the same rects and rows
+    TestLayout(section, 4, 200, count, NULL, kVerticalParams);
+    for (size_t i = 0; i < count; i++) {
+        CHECK(TestSameRect(SMGridViewLayoutSectionGetRect(section, i), rects[i]));
+    }
+    CHECK(memcmp(finalPositions, SMGridViewLayoutSectionGetPositions(section), sizeof(finalPositions)) == 0);
+
+    // A changed rect drops the checkpoints after it
+    SMGridViewLayoutRect rect = rects[70];
+    rect.height += 10;
+    SMGridViewLayoutSectionSetRect(section, 70, rect);
+    CHECK(SMGridViewLayoutSectionRestoreCheckpoint(section, 250) == 64);
+    // And so do removes and inserts
+    TestLayout(section, 4, 0, count, NULL, kVerticalParams);
+    SMGridViewLayoutSectionRemoveItem(section, 150);
+    CHECK(SMGridViewLayoutSectionRestoreCheckpoint(section, 250) == 128);
+    SMGridViewLayoutSectionInsertItem(section, 10);
+    CHECK(SMGridViewLayoutSectionRestoreCheckpoint(section, 250) == 0);
+    // Reset positions have no checkpoints
+    SMGridViewLayoutSectionResetPositions(section, 4, 0);
+    CHECK(SMGridViewLayoutSectionRestoreCheckpoint(section, 250) == SMGridViewLayoutNotFound);
+
+    free(rects);
+    SMGridViewLayoutSectionFree(section);
+}
+
+static void TestMoveItemAndRelayout(void) {
+    size_t count = 1000;
+    float *heights = malloc(count * sizeof(float));
+    float *movedHeights = malloc(count * sizeof(float));
+    for (size_t i = 0; i < count; i++) {
+        heights[i] = 40 + (i * 7) % 4 * 20;
+    }
+    size_t local = 0;
+    for (size_t t = 0; t < 200; t++) {
+        size_t from = (t * 131) % count;
+        size_t to = (t * 71 + 5) % count;
+        if (t % 2) {
+            // Neighbours, the moves of a drag
+            to = from + 1 < count ? from + 1 : from - 1;
+        }
+        SMGridViewLayoutSection *moved = SMGridViewLayoutSectionCreate();
+        SMGridViewLayoutSection *expected = SMGridViewLayoutSectionCreate();
+        TestLayout(moved, 5, 0, count, heights, kVerticalParams);
+        // Builds the index, so it has to be patched
+        CHECK(TestEnumerationMatches(moved, 0, 100, true));
+        bool same = SMGridViewLayoutSectionMoveItemAndRelayout(moved, from, to, kVerticalParams);
+
+        memcpy(movedHeights, heights, count * sizeof(float));
+        float height = movedHeights[from];
+        if (from < to) {
+            memmove(movedHeights + from, movedHeights + from + 1, (to - from) * sizeof(float));
+        } else {
+            memmove(movedHeights + to + 1, movedHeights + to, (from - to) * sizeof(float));
+        }
+        movedHeights[to] = height;
+        TestLayout(expected, 5, 0, count, movedHeights, kVerticalParams);
+        if (same) {
+            local++;
+            for (size_t i = 0; i < count; i++) {
+                CHECK(TestSameRect(SMGridViewLayoutSectionGetRect(moved, i), SMGridViewLayoutSectionGetRect(expected, i)));
+            }
+            CHECK(memcmp(SMGridViewLayoutSectionGetPositions(moved), SMGridViewLayoutSectionGetPositions(expected), 5 * sizeof(double)) == 0);
+            for (double start = 0; start < 30000; start += 700) {
+                CHECK(TestEnumerationMatches(moved, start, start + 400, true));
+            }
+        } else {
+            // The caller lays out the rest, sizes have to be in place for that
+            CHECK(SMGridViewLayoutSectionGetRect(moved, to).height == height);
+        }
+        SMGridViewLayoutSectionFree(moved);
+        SMGridViewLayoutSectionFree(expected);
+    }
+    // Many moves don't change the rows at the next checkpoint, those stay local
+    CHECK(local >= 40);
+    free(heights);
+    free(movedHeights);
+}
+
+
+// Interval index
+
+static void TestIntervalIndex(void) {
+    SMGridViewLayoutSection *section = SMGridViewLayoutSectionCreate();
+    TestLayout(section, 3, 0, 500, NULL, kVerticalParams);
+    for (double start = -50; start < 15000; start += 37) {
+        CHECK(TestEnumerationMatches(section, start, start + 480, true));
+    }
+    CHECK(TestEnumerationMatches(section, 100, 100, true));
+
+    // Appended items extend the index
+    TestLayout(section, 3, 500, 700, NULL, kVerticalParams);
+    CHECK(TestEnumerationMatches(section, 14000, 20000, true));
+
+    // Min edges out of item order need the sorted index
+    SMGridViewLayoutRect rect = SMGridViewLayoutSectionGetRect(section, 10);
+    rect.y = 9000;
+    SMGridViewLayoutSectionSetRect(section, 10, rect);
+    CHECK(TestEnumerationMatches(section, 8900, 9100, true));
+    CHECK(TestEnumerationMatches(section, 0, 400, true));
+
+    // The other axis builds it again
+    CHECK(TestEnumerationMatches(section, 0, 120, false));
+    CHECK(TestEnumerationMatches(section, 60, 61, false));
+
+    // Stop ends the enumeration
+    TestItems items = {malloc(700 * sizeof(size_t)), 0};
+    SMGridViewLayoutSectionEnumerateItems(section, 0, 1e9, true, TestCollect, &items);
+    CHECK(items.count == 700);
+    free(items.items);
+
+    // Shifting the whole section moves the index with it
+    SMGridViewLayoutSectionShift(section, 1000, true);
+    CHECK(SMGridViewLayoutSectionGetRect(section, 0).y == 1005);
+    CHECK(SMGridViewLayoutSectionGetLayoutStart(section) == 1000);
+    CHECK(TestEnumerationMatches(section, 1000, 2000, true));
+    SMGridViewLayoutSectionFree(section);
+}
+
+
+// Paging
+
+static void TestPaging(void) {
+    SMGridViewLayoutSection *section = SMGridViewLayoutSectionCreate();
+    SMGridViewLayoutSectionSetCount(section, 13);
+    // 2 rows of 3 items per page
+    SMGridViewLayoutSectionSetPaging(section, 3, 6, 1);
+    CHECK(SMGridViewLayoutSectionGetPageCount(section) == 3);
+    CHECK(SMGridViewLayoutSectionGetItemsPerRow(section) == 3);
+    CHECK(SMGridViewLayoutSectionGetItemsPerPage(section) == 6);
+    CHECK(SMGridViewLayoutSectionGetFirstPage(section) == 1);
+    CHECK(SMGridViewLayoutSectionPageForItem(section, 0) == 1);
+    CHECK(SMGridViewLayoutSectionPageForItem(section, 6) == 2);
+    CHECK(SMGridViewLayoutSectionPageForItem(section, 12) == 3);
+
+    // Normal order fills a line across the rows, inverse order fills a row first
+    CHECK(SMGridViewLayoutSectionIsFirstOfPage(section, 6, false));
+    CHECK(SMGridViewLayoutSectionIsFirstOfPage(section, 7, false));
+    CHECK(!SMGridViewLayoutSectionIsFirstOfPage(section, 8, false));
+    CHECK(SMGridViewLayoutSectionIsFirstOfPage(section, 9, true));
+    CHECK(!SMGridViewLayoutSectionIsFirstOfPage(section, 10, true));
+    CHECK(SMGridViewLayoutSectionPagingRowForItem(section, 4) == 1);
+    CHECK(SMGridViewLayoutSectionPagingRowForItem(section, 7) == 0);
+
+    // The first items of a page start at the page
+    SMGridViewLayoutParams params = {10, false, 320, false};
+    SMGridViewLayoutSectionResetPositions(section, 2, 10);
+    SMGridViewLayoutSize size = {90, 90};
+    SMGridViewLayoutRect rect = SMGridViewLayoutSectionRectForItem(section, 6, 0, size, params);
+    CHECK(rect.x == 2 * 320 + 10);
+    CHECK(rect.y == 10);
+    rect = SMGridViewLayoutSectionRectForItem(section, 8, 0, size, params);
+    CHECK(rect.x == 10);
+    params.inverseOrder = true;
+    SMGridViewLayoutSectionSetPosition(section, 1, 500);
+    CHECK(SMGridViewLayoutSectionRowForItem(section, 4, params) == 1);
+
+    // Closest page rounds, ties go to the previous one
+    CHECK(SMGridViewLayoutClosestPage(0, 320, 3) == 0);
+    CHECK(SMGridViewLayoutClosestPage(159, 320, 3) == 0);
+    CHECK(SMGridViewLayoutClosestPage(160, 320, 3) == 0);
+    CHECK(SMGridViewLayoutClosestPage(161, 320, 3) == 1);
+    CHECK(SMGridViewLayoutClosestPage(5000, 320, 3) == 2);
+    CHECK(SMGridViewLayoutClosestPage(-500, 320, 3) == 0);
+    CHECK(SMGridViewLayoutClosestPage(100, 0, 3) == 0);
+
+    // Without pages everything is in the first one
+    SMGridViewLayoutSectionSetPaging(section, 0, 0, 4);
+    CHECK(SMGridViewLayoutSectionGetPageCount(section) == 0);
+    CHECK(SMGridViewLayoutSectionPageForItem(section, 12) == 4);
+    CHECK(SMGridViewLayoutSectionIsFirstOfPage(section, 12, false));
+    SMGridViewLayoutSectionFree(section);
+}
+
+
+// Same size sections
+
+static void TestUniformSections(void) {
+    size_t count = 1003;
+    float *heights = malloc(count * sizeof(float));
+    for (size_t i = 0; i < count; i++) {
+        heights[i] = 60;
+    }
+    SMGridViewLayoutSection *perItem = SMGridViewLayoutSectionCreate();
+    TestLayout(perItem, 4, 0, count, heights, kVerticalParams);
+
+    SMGridViewLayoutSection *uniform = SMGridViewLayoutSectionCreate();
+    SMGridViewLayoutSectionSetCount(uniform, count);
+    SMGridViewLayoutSectionSetFlags(uniform, 7, 3);
+    SMGridViewLayoutSize size = {50, 60};
+    SMGridViewLayoutSectionUseUniformSize(uniform, size);
+    CHECK(SMGridViewLayoutSectionIsUniform(uniform));
+    CHECK(SMGridViewLayoutSectionGetUniformSize(uniform).height == 60);
+    SMGridViewLayoutSectionResetPositions(uniform, 4, 5);
+    SMGridViewLayoutSectionLayoutUniform(uniform, 5, kVerticalParams);
+    CHECK(SMGridViewLayoutSectionGetUniformStart(uniform) == 5);
+    CHECK(SMGridViewLayoutSectionGetLayoutCount(uniform) == count);
+
+    // Same rects and rows as laying out every item
+    for (size_t i = 0; i < count; i++) {
+        CHECK(TestSameRect(SMGridViewLayoutSectionGetRect(uniform, i), SMGridViewLayoutSectionGetRect(perItem, i)));
+    }
+    CHECK(memcmp(SMGridViewLayoutSectionGetPositions(uniform), SMGridViewLayoutSectionGetPositions(perItem), 4 * sizeof(double)) == 0);
+    CHECK(SMGridViewLayoutSectionGetMaxPosition(uniform) == SMGridViewLayoutSectionGetMaxPosition(perItem));
+    for (double start = -100; start < 16000; start += 53) {
+        CHECK(TestEnumerationMatches(uniform, start, start + 480, true));
+    }
+
+    // Flags are kept sparse, and follow the items
+    CHECK(SMGridViewLayoutSectionGetFlags(uniform, 7) == 3);
+    CHECK(SMGridViewLayoutSectionGetFlags(uniform, 8) == 0);
+    SMGridViewLayoutSectionInsertItem(uniform, 2);
+    CHECK(SMGridViewLayoutSectionGetFlags(uniform, 8) == 3);
+    CHECK(SMGridViewLayoutSectionGetCount(uniform) == count + 1);
+    SMGridViewLayoutSectionRemoveItem(uniform, 0);
+    CHECK(SMGridViewLayoutSectionGetFlags(uniform, 7) == 3);
+    SMGridViewLayoutSectionMoveItem(uniform, 7, 100);
+    CHECK(SMGridViewLayoutSectionGetFlags(uniform, 100) == 3);
+    CHECK(SMGridViewLayoutSectionGetFlags(uniform, 7) == 0);
+    SMGridViewLayoutSectionMoveItem(uniform, 100, 3);
+    CHECK(SMGridViewLayoutSectionGetFlags(uniform, 3) == 3);
+    // Moves keep the rects, they only depend on the index
+    CHECK(SMGridViewLayoutSectionMoveItemAndRelayout(uniform, 3, 4, kVerticalParams));
+    CHECK(SMGridViewLayoutSectionGetFlags(uniform, 4) == 3);
+
+    // Shifting moves the start
+    SMGridViewLayoutSectionShift(uniform, 100, true);
+    CHECK(SMGridViewLayoutSectionGetRect(uniform, 0).y == 105);
+
+    // Back to per item rects, with the flags in place
+    SMGridViewLayoutSectionUsePerItemRects(uniform);
+    CHECK(!SMGridViewLayoutSectionIsUniform(uniform));
+    CHECK(SMGridViewLayoutSectionGetLayoutCount(uniform) == 0);
+    CHECK(SMGridViewLayoutSectionGetFlags(uniform, 4) == 3);
+
+    // Paging, every page starts at the page size
+    SMGridViewLayoutSection *paged = SMGridViewLayoutSectionCreate();
+    SMGridViewLayoutParams params = {10, false, 320, false};
+    SMGridViewLayoutSectionSetCount(paged, 50);
+    SMGridViewLayoutSectionUseUniformSize(paged, (SMGridViewLayoutSize){90, 90});
+    SMGridViewLayoutSectionSetPaging(paged, 3, 9, 0);
+    SMGridViewLayoutSectionResetPositions(paged, 3, 10);
+    SMGridViewLayoutSectionLayoutUniform(paged, 10, params);
+    CHECK(SMGridViewLayoutSectionGetRect(paged, 9).x == 330);
+    CHECK(SMGridViewLayoutSectionGetRect(paged, 10).y == 110);
+    for (double start = 0; start < 2000; start += 80) {
+        CHECK(TestEnumerationMatches(paged, start, start + 320, false));
+    }
+
+    free(heights);
+    SMGridViewLayoutSectionFree(perItem);
+    SMGridViewLayoutSectionFree(uniform);
+    SMGridViewLayoutSectionFree(paged);
+}
+
+
+// Inserts
+
+static void TestInsertAndShiftItems(void) {
+    SMGridViewLayoutSection *section = SMGridViewLayoutSectionCreate();
+    TestLayout(section, 3, 0, 10, NULL, kVerticalParams);
+    SMGridViewLayoutRect first = SMGridViewLayoutSectionGetRect(section, 0);
+    SMGridViewLayoutSectionInsertItems(section, 0, 5);
+    CHECK(SMGridViewLayoutSectionGetCount(section) == 15);
+    CHECK(SMGridViewLayoutSectionGetLayoutCount(section) == 15);
+    CHECK(SMGridViewLayoutSectionGetRect(section, 0).height == 0);
+    CHECK(TestSameRect(SMGridViewLayoutSectionGetRect(section, 5), first));
+
+    SMGridViewLayoutSectionShiftItems(section, 5, 100, true);
+    CHECK(SMGridViewLayoutSectionGetRect(section, 5).y == first.y + 100);
+    CHECK(SMGridViewLayoutSectionGetRect(section, 5).x == first.x);
+
+    // Checkpoints after the shifted items move with them, the ones before stay. The insert at the start
+    // took free slots, so they are not at multiples of the interval anymore
+    TestLayout(section, 3, 0, 300, NULL, kVerticalParams);
+    size_t moved = SMGridViewLayoutSectionRestoreCheckpoint(section, 250);
+    CHECK(moved > 186 && moved <= 250);
+    double before[3];
+    memcpy(before, SMGridViewLayoutSectionGetPositions(section), sizeof(before));
+    size_t stayed = SMGridViewLayoutSectionRestoreCheckpoint(section, 70);
+    CHECK(stayed > 6 && stayed <= 70);
+    double kept[3];
+    memcpy(kept, SMGridViewLayoutSectionGetPositions(section), sizeof(kept));
+    SMGridViewLayoutSectionShiftItems(section, 100, 40, true);
+    CHECK(SMGridViewLayoutSectionRestoreCheckpoint(section, 250) == moved);
+    for (size_t row = 0; row < 3; row++) {
+        CHECK(SMGridViewLayoutSectionGetPositions(section)[row] == before[row] + 40);
+    }
+    CHECK(SMGridViewLayoutSectionRestoreCheckpoint(section, 70) == stayed);
+    CHECK(memcmp(SMGridViewLayoutSectionGetPositions(section), kept, sizeof(kept)) == 0);
+    CHECK(TestEnumerationMatches(section, 2000, 2600, true));
+
+    // Inserting after the laid out ones doesn't lay them out
+    SMGridViewLayoutSectionSetLayoutCount(section, 10);
+    SMGridViewLayoutSectionInsertItems(section, 12, 3);
+    CHECK(SMGridViewLayoutSectionGetLayoutCount(section) == 10);
+    CHECK(SMGridViewLayoutSectionGetCount(section) == 303);
+    SMGridViewLayoutSectionFree(section);
+}
+
+static bool TestSameLayout(SMGridViewLayoutSection *section, SMGridViewLayoutSection *expected) {
+    size_t count = SMGridViewLayoutSectionGetCount(expected);
+    size_t rows = SMGridViewLayoutSectionGetNumberOfRows(expected);
+    bool same = SMGridViewLayoutSectionGetCount(section) == count && SMGridViewLayoutSectionGetNumberOfRows(section) == rows;
+    for (size_t i = 0; i < count && same; i++) {
+        same = TestSameRect(SMGridViewLayoutSectionGetRect(section, i), SMGridViewLayoutSectionGetRect(expected, i));
+    }
+    return same && memcmp(SMGridViewLayoutSectionGetPositions(section), SMGridViewLayoutSectionGetPositions(expected), rows * sizeof(double)) == 0;
+}
+
+static void TestPrependItems(void) {
+    size_t count = 500;
+    float *heights = malloc((count + 30 * 6 + 1) * sizeof(float));
+    for (size_t i = 0; i < count; i++) {
+        heights[i] = TestHeight(i);
+    }
+    SMGridViewLayoutSection *section = SMGridViewLayoutSectionCreate();
+    TestLayout(section, 3, 0, count, heights, kVerticalParams);
+    CHECK(TestEnumerationMatches(section, 0, 1000, true));
+
+    // Six items of the same height add the same to each of the three rows, the items after them only move.
+    // Thirty prepends go past the free slots reserved the first time
+    SMGridViewLayoutSize sizes[6];
+    for (size_t i = 0; i < 6; i++) {
+        sizes[i] = (SMGridViewLayoutSize){50, 60};
+    }
+    for (size_t t = 0; t < 30; t++) {
+        CHECK(SMGridViewLayoutSectionPrependItems(section, sizes, 6, 1, kVerticalParams));
+        memmove(heights + 6, heights, count * sizeof(float));
+        for (size_t i = 0; i < 6; i++) {
+            heights[i] = 60;
+        }
+        count += 6;
+        CHECK(TestEnumerationMatches(section, 1000 + t * 100, 1500 + t * 100, true));
+    }
+    CHECK(SMGridViewLayoutSectionGetLayoutCount(section) == count);
+    CHECK(SMGridViewLayoutSectionGetFlags(section, 0) == 1);
+    CHECK(SMGridViewLayoutSectionGetFlags(section, 180) == 0);
+    SMGridViewLayoutSection *expected = SMGridViewLayoutSectionCreate();
+    TestLayout(expected, 3, 0, count, heights, kVerticalParams);
+    CHECK(TestSameLayout(section, expected));
+    for (double start = 0; start < 30000; start += 700) {
+        CHECK(TestEnumerationMatches(section, start, start + 400, true));
+    }
+
+    // Moving the whole section only changes the offset
+    SMGridViewLayoutRect rect = SMGridViewLayoutSectionGetRect(section, 300);
+    SMGridViewLayoutSectionShift(section, 1000, true);
+    CHECK(SMGridViewLayoutSectionGetRect(section, 300).y == rect.y + 1000);
+    CHECK(TestEnumerationMatches(section, rect.y + 1000, rect.y + 1400, true));
+    SMGridViewLayoutSectionShift(section, -1000, true);
+
+    // Checkpoints of the old items moved with them, laying out again from one gives the same
+    CHECK(SMGridViewLayoutSectionRestoreCheckpoint(section, 400) != SMGridViewLayoutNotFound);
+    TestLayout(section, 3, 400, count, heights, kVerticalParams);
+    CHECK(TestSameLayout(section, expected));
+    TestLayout(section, 3, 20, count, heights, kVerticalParams);
+    CHECK(TestSameLayout(section, expected));
+
+    // With one item the rows don't move by the same amount, the section has to be laid out again
+    CHECK(!SMGridViewLayoutSectionPrependItems(section, sizes, 1, 1, kVerticalParams));
+    memmove(heights + 1, heights, count * sizeof(float));
+    heights[0] = 60;
+    count++;
+    CHECK(SMGridViewLayoutSectionGetRect(section, 0).height == 60);
+    TestLayout(section, 3, 0, count, heights, kVerticalParams);
+    TestLayout(expected, 3, 0, count, heights, kVerticalParams);
+    CHECK(TestSameLayout(section, expected));
+
+    free(heights);
+    SMGridViewLayoutSectionFree(section);
+    SMGridViewLayoutSectionFree(expected);
+}
+
+
+// Sections
+
+static void TestBoundsSearch(void) {
+    // Sections one after the other, with an empty one in the middle
+    SMGridViewLayoutBounds bounds[] = {{0, 100}, {100, 250}, {250, 250}, {250, 400}, {400, 1e9}};
+    size_t count = sizeof(bounds) / sizeof(bounds[0]);
+    double positions[] = {-1, 0, 50, 100, 249, 250, 251, 400, 1e9, 2e9};
+    for (size_t p = 0; p < sizeof(positions) / sizeof(positions[0]); p++) {
+        for (int useEnd = 0; useEnd < 2; useEnd++) {
+            for (int orAt = 0; orAt < 2; orAt++) {
+                size_t expected = count;
+                for (size_t i = 0; i < count; i++) {
+                    double value = useEnd ? bounds[i].end : bounds[i].start;
+                    if (value > positions[p] || (orAt && value == positions[p])) {
+                        expected = i;
+                        break;
+                    }
+                }
+                CHECK(SMGridViewLayoutBoundsSearch(bounds, count, positions[p], useEnd, orAt) == expected);
+            }
+        }
+    }
+    CHECK(SMGridViewLayoutBoundsSearch(bounds, 0, 10, false, false) == 0);
+}
+
+
+int main(void) {
+    TestRowPlacement();
+    TestLargeCoordinates();
+    TestCheckpoints();
+    TestMoveItemAndRelayout();
+    TestIntervalIndex();
+    TestPaging();
+    TestUniformSections();
+    TestInsertAndShiftItems();
+    TestPrependItems();
+    TestBoundsSearch();
+    if (failures > 0) {
+        fprintf(stderr, "%d checks failed\n", failures);
+        return 1;
+    }
+    printf("All layout tests passed\n");
+    return 0;
+}